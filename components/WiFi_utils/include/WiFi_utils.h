@@ -8,6 +8,85 @@
 
 esp_err_t nvs_init(void);
 
+/* NVS CACHE */
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+
+#define NVS_CACHE_TAG "NVS CACHE"
+#define NVS_CACHE_MAX_ENTRIES 16
+#define NVS_CACHE_MAX_VALUE_SIZE 64
+#define NVS_CACHE_TASK_STACK_SIZE 4096
+#define NVS_CACHE_TASK_PRIORITY 5
+
+typedef enum
+{
+    NVS_CACHE_TYPE_U32,
+    NVS_CACHE_TYPE_I32,
+    NVS_CACHE_TYPE_STR,
+    NVS_CACHE_TYPE_BLOB
+} nvs_cache_type_t;
+
+typedef struct
+{
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    nvs_cache_type_t type;
+    bool used;
+    bool dirty;
+    bool persisted;
+    size_t persisted_length;
+    size_t length;
+    uint8_t value[NVS_CACHE_MAX_VALUE_SIZE];
+} nvs_cache_entry_t;
+
+typedef struct
+{
+    uint32_t write_count;
+    uint32_t skipped_write_count;
+    uint32_t commit_count;
+    uint32_t committed_entry_count;
+    uint32_t failed_commit_count;
+    uint32_t compaction_count;
+    int64_t last_commit_latency_us;
+    int64_t max_commit_latency_us;
+    int64_t total_commit_latency_us;
+} nvs_cache_stats_t;
+
+typedef struct
+{
+    const char *namespace_name;
+    uint32_t commit_interval_ms;
+    uint8_t commit_threshold;
+} nvs_cache_config_t;
+
+typedef struct
+{
+    nvs_handle_t nvs_handle;
+    SemaphoreHandle_t mutex;
+    esp_timer_handle_t commit_timer;
+    TaskHandle_t commit_task;
+    uint32_t commit_interval_ms;
+    uint8_t commit_threshold;
+    uint8_t dirty_count;
+    bool complete;
+    nvs_cache_entry_t entries[NVS_CACHE_MAX_ENTRIES];
+    nvs_cache_stats_t stats;
+} nvs_cache_handle_t;
+
+esp_err_t nvs_cache_init(nvs_cache_handle_t *nvs_cache, nvs_cache_config_t nvs_cache_config);
+esp_err_t nvs_cache_set_u32(nvs_cache_handle_t *nvs_cache, const char *key, uint32_t value);
+esp_err_t nvs_cache_get_u32(nvs_cache_handle_t *nvs_cache, const char *key, uint32_t *value);
+esp_err_t nvs_cache_set_i32(nvs_cache_handle_t *nvs_cache, const char *key, int32_t value);
+esp_err_t nvs_cache_get_i32(nvs_cache_handle_t *nvs_cache, const char *key, int32_t *value);
+esp_err_t nvs_cache_set_str(nvs_cache_handle_t *nvs_cache, const char *key, const char *value);
+esp_err_t nvs_cache_get_str(nvs_cache_handle_t *nvs_cache, const char *key, char *value, size_t *length);
+esp_err_t nvs_cache_set_blob(nvs_cache_handle_t *nvs_cache, const char *key, const void *value, size_t length);
+esp_err_t nvs_cache_get_blob(nvs_cache_handle_t *nvs_cache, const char *key, void *value, size_t *length);
+esp_err_t nvs_cache_commit(nvs_cache_handle_t *nvs_cache);
+void nvs_cache_get_stats(nvs_cache_handle_t *nvs_cache, nvs_cache_stats_t *stats);
+esp_err_t nvs_cache_deinit(nvs_cache_handle_t *nvs_cache);
+
 /* WIFI STATION MODE */
 #include <string.h>
 #include <esp_event.h>
@@ -60,14 +139,73 @@ typedef enum
     CONTENT_TYPE_OCTET_STREAM
 } content_type_t;
 
+/* Fields can be extracted down to HTTPX_JSON_MAX_DEPTH levels; deeper values are
+ * skipped, up to HTTPX_JSON_MAX_NESTING levels in total */
+#define HTTPX_JSON_MAX_DEPTH 8
+#define HTTPX_JSON_MAX_NESTING 256
+#define HTTPX_JSON_KEY_MAX_SIZE 32
+#define HTTPX_JSON_SCALAR_MAX_SIZE 32
+
+typedef enum
+{
+    HTTPX_JSON_TYPE_STRING,
+    HTTPX_JSON_TYPE_INT,
+    HTTPX_JSON_TYPE_DOUBLE,
+    HTTPX_JSON_TYPE_BOOL
+} httpx_json_type_t;
+
+typedef struct
+{
+    const char *path;
+    httpx_json_type_t type;
+    void *value;
+    size_t value_size;
+    bool found;
+} httpx_json_field_t;
+
+typedef struct
+{
+    char key[HTTPX_JSON_KEY_MAX_SIZE];
+    uint32_t index;
+    bool key_truncated;
+} httpx_json_level_t;
+
+typedef struct
+{
+    httpx_json_field_t *fields;
+    size_t field_count;
+    httpx_json_level_t levels[HTTPX_JSON_MAX_DEPTH];
+    uint8_t arrays[HTTPX_JSON_MAX_NESTING / 8];
+    uint16_t depth;
+    uint8_t state;
+    bool in_key;
+    size_t key_length;
+    httpx_json_field_t *capture;
+    size_t capture_length;
+    char scalar[HTTPX_JSON_SCALAR_MAX_SIZE];
+    size_t scalar_length;
+    uint8_t number_state;
+    uint32_t unicode;
+    uint8_t unicode_digits;
+    uint32_t high_surrogate;
+} httpx_json_parser_t;
+
+/* fields[].found and value are only reliable once httpx_json_parser_finish returns
+ * ESP_OK; after an error they may describe part of the document */
+void httpx_json_parser_init(httpx_json_parser_t *parser, httpx_json_field_t *fields, size_t field_count);
+esp_err_t httpx_json_parser_feed(httpx_json_parser_t *parser, const char *data, size_t length);
+esp_err_t httpx_json_parser_finish(httpx_json_parser_t *parser);
+
 typedef struct
 {
     char *buffer;
     size_t length;
+    httpx_json_parser_t *json_parser;
 } httpx_client_response_t;
 
 esp_err_t httpx_rest_url_data(char *url, esp_http_client_method_t method, const char *cert_pem, const void *send_data, size_t data_size, content_type_t content_type);
 #define httpx_rest_url(url, method, cert_pem) httpx_rest_url_data(url, method, cert_pem, NULL, 0, 0)
+esp_err_t httpx_rest_url_data_json(char *url, esp_http_client_method_t method, const char *cert_pem, const void *send_data, size_t data_size, content_type_t content_type, httpx_json_field_t *fields, size_t field_count);
 
 /* HTTPS SERVER */
 #include <esp_http_server.h>
@@ -1,4 +1,7 @@
 #include "WiFi_utils.h"
+#include <esp_timer.h>
+#include <errno.h>
+#include <math.h>
 
 /* NVS */
 esp_err_t nvs_init(void)
@@ -26,6 +29,534 @@ esp_err_t nvs_init(void)
     return err;
 }
 
+/* NVS CACHE */
+static nvs_cache_entry_t *nvs_cache_find(nvs_cache_handle_t *nvs_cache, const char *key)
+{
+    for (size_t i = 0; i < NVS_CACHE_MAX_ENTRIES; i++)
+    {
+        if (nvs_cache->entries[i].used && strcmp(nvs_cache->entries[i].key, key) == 0)
+            return &nvs_cache->entries[i];
+    }
+    return NULL;
+}
+
+static nvs_cache_entry_t *nvs_cache_alloc(nvs_cache_handle_t *nvs_cache, const char *key, nvs_cache_type_t type)
+{
+    for (size_t i = 0; i < NVS_CACHE_MAX_ENTRIES; i++)
+    {
+        nvs_cache_entry_t *entry = &nvs_cache->entries[i];
+        if (!entry->used)
+        {
+            memset(entry, 0, sizeof(*entry));
+            strlcpy(entry->key, key, sizeof(entry->key));
+            entry->type = type;
+            entry->used = true;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static esp_err_t nvs_cache_read_entry(nvs_cache_handle_t *nvs_cache, nvs_cache_entry_t *entry)
+{
+    size_t length = sizeof(entry->value);
+    esp_err_t err;
+    switch (entry->type)
+    {
+    case NVS_CACHE_TYPE_U32:
+    {
+        uint32_t value = 0;
+        length = sizeof(value);
+        err = nvs_get_u32(nvs_cache->nvs_handle, entry->key, &value);
+        memcpy(entry->value, &value, length);
+        break;
+    }
+    case NVS_CACHE_TYPE_I32:
+    {
+        int32_t value = 0;
+        length = sizeof(value);
+        err = nvs_get_i32(nvs_cache->nvs_handle, entry->key, &value);
+        memcpy(entry->value, &value, length);
+        break;
+    }
+    case NVS_CACHE_TYPE_STR:
+        err = nvs_get_str(nvs_cache->nvs_handle, entry->key, (char *)entry->value, &length);
+        break;
+    case NVS_CACHE_TYPE_BLOB:
+        err = nvs_get_blob(nvs_cache->nvs_handle, entry->key, entry->value, &length);
+        break;
+    default:
+        return ESP_ERR_NVS_TYPE_MISMATCH;
+    }
+    entry->length = length;
+    if (err == ESP_OK)
+    {
+        entry->persisted = true;
+        entry->persisted_length = length;
+    }
+
+    return err;
+}
+
+static esp_err_t nvs_cache_write_entry(nvs_cache_handle_t *nvs_cache, const nvs_cache_entry_t *entry)
+{
+    switch (entry->type)
+    {
+    case NVS_CACHE_TYPE_U32:
+    {
+        uint32_t value;
+        memcpy(&value, entry->value, sizeof(value));
+        return nvs_set_u32(nvs_cache->nvs_handle, entry->key, value);
+    }
+    case NVS_CACHE_TYPE_I32:
+    {
+        int32_t value;
+        memcpy(&value, entry->value, sizeof(value));
+        return nvs_set_i32(nvs_cache->nvs_handle, entry->key, value);
+    }
+    case NVS_CACHE_TYPE_STR:
+        return nvs_set_str(nvs_cache->nvs_handle, entry->key, (const char *)entry->value);
+    case NVS_CACHE_TYPE_BLOB:
+        return nvs_set_blob(nvs_cache->nvs_handle, entry->key, entry->value, entry->length);
+    default:
+        return ESP_ERR_NVS_TYPE_MISMATCH;
+    }
+}
+
+static esp_err_t nvs_cache_preload(nvs_cache_handle_t *nvs_cache, const char *namespace_name)
+{
+    nvs_iterator_t it = NULL;
+    esp_err_t err = nvs_entry_find(NVS_DEFAULT_PART_NAME, namespace_name, NVS_TYPE_ANY, &it);
+    nvs_cache->complete = true;
+    while (err == ESP_OK)
+    {
+        nvs_entry_info_t info;
+        nvs_entry_info(it, &info);
+        nvs_cache_type_t type;
+        bool supported = true;
+        switch (info.type)
+        {
+        case NVS_TYPE_U32:
+            type = NVS_CACHE_TYPE_U32;
+            break;
+        case NVS_TYPE_I32:
+            type = NVS_CACHE_TYPE_I32;
+            break;
+        case NVS_TYPE_STR:
+            type = NVS_CACHE_TYPE_STR;
+            break;
+        case NVS_TYPE_BLOB:
+            type = NVS_CACHE_TYPE_BLOB;
+            break;
+        default:
+            supported = false;
+            break;
+        }
+        nvs_cache_entry_t *entry = supported ? nvs_cache_alloc(nvs_cache, info.key, type) : NULL;
+        if (!entry || nvs_cache_read_entry(nvs_cache, entry) != ESP_OK)
+        {
+            ESP_LOGW(NVS_CACHE_TAG, "Key \"%s\" is not cached, reads go to flash", info.key);
+            if (entry)
+                entry->used = false;
+            nvs_cache->complete = false;
+        }
+        err = nvs_entry_next(&it);
+    }
+    nvs_release_iterator(it);
+
+    return err == ESP_ERR_NVS_NOT_FOUND ? ESP_OK : err;
+}
+
+/* Number of 32 byte NVS entries a value occupies: one header entry, plus the data
+ * entries of strings and blobs (blobs also carry a blob index entry) */
+static size_t nvs_cache_entry_span(nvs_cache_type_t type, size_t length)
+{
+    switch (type)
+    {
+    case NVS_CACHE_TYPE_STR:
+        return 1 + (length + 31) / 32;
+    case NVS_CACHE_TYPE_BLOB:
+        return 2 + (length + 31) / 32;
+    default:
+        return 1;
+    }
+}
+
+/* NVS writes the new copy of a key before erasing the old one, so an update can
+ * fail for lack of space even though the new value would fit where the old one
+ * is. Erase the old copy first, but only once the new value is known to fit in the
+ * space that frees. Nothing else in the namespace is touched; a power loss between
+ * the erase and the write can only lose this one key. */
+static esp_err_t nvs_cache_compact_locked(nvs_cache_handle_t *nvs_cache, nvs_cache_entry_t *entry)
+{
+    if (!entry->persisted)
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    nvs_stats_t nvs_stats;
+    esp_err_t err = nvs_get_stats(NVS_DEFAULT_PART_NAME, &nvs_stats);
+    if (err != ESP_OK)
+        return err;
+    if (nvs_cache_entry_span(entry->type, entry->length) > nvs_stats.available_entries + nvs_cache_entry_span(entry->type, entry->persisted_length))
+    {
+        ESP_LOGE(NVS_CACHE_TAG, "Key \"%s\" does not fit even in place of its old value", entry->key);
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    ESP_LOGW(NVS_CACHE_TAG, "Rewriting key \"%s\" in place", entry->key);
+    if ((err = nvs_erase_key(nvs_cache->nvs_handle, entry->key)) != ESP_OK)
+        return err;
+    entry->persisted = false;
+    if ((err = nvs_cache_write_entry(nvs_cache, entry)) != ESP_OK)
+        return err;
+    nvs_cache->stats.compaction_count++;
+
+    return err;
+}
+
+static esp_err_t nvs_cache_commit_locked(nvs_cache_handle_t *nvs_cache)
+{
+    if (nvs_cache->dirty_count == 0)
+        return ESP_OK;
+
+    if (nvs_cache->commit_timer && esp_timer_is_active(nvs_cache->commit_timer))
+        esp_timer_stop(nvs_cache->commit_timer);
+
+    int64_t start_us = esp_timer_get_time();
+    uint32_t written = 0;
+    esp_err_t err = ESP_OK;
+    /* Updates of keys already in flash go first, as each one releases the old copy
+     * that new keys may need. A failed key stays dirty and does not stop the rest. */
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (size_t i = 0; i < NVS_CACHE_MAX_ENTRIES; i++)
+        {
+            nvs_cache_entry_t *entry = &nvs_cache->entries[i];
+            if (!entry->used || !entry->dirty || entry->persisted != (pass == 0))
+                continue;
+            esp_err_t entry_err = nvs_cache_write_entry(nvs_cache, entry);
+            if (entry_err == ESP_ERR_NVS_NOT_ENOUGH_SPACE)
+                entry_err = nvs_cache_compact_locked(nvs_cache, entry);
+            if (entry_err != ESP_OK)
+            {
+                ESP_LOGE(NVS_CACHE_TAG, "Failed to write key \"%s\"", entry->key);
+                if (err == ESP_OK)
+                    err = entry_err;
+                continue;
+            }
+            entry->persisted = true;
+            entry->persisted_length = entry->length;
+            written |= 1UL << i;
+        }
+    }
+    if (written)
+    {
+        esp_err_t commit_err = nvs_commit(nvs_cache->nvs_handle);
+        if (commit_err != ESP_OK)
+        {
+            written = 0;
+            err = commit_err;
+        }
+    }
+    uint8_t committed = 0;
+    for (size_t i = 0; i < NVS_CACHE_MAX_ENTRIES; i++)
+    {
+        if (written & (1UL << i))
+        {
+            nvs_cache->entries[i].dirty = false;
+            committed++;
+        }
+    }
+    nvs_cache->dirty_count -= committed;
+    if (err != ESP_OK)
+    {
+        nvs_cache->stats.failed_commit_count++;
+        ESP_LOGE(NVS_CACHE_TAG, "Failed to commit %u of %u dirty entries", nvs_cache->dirty_count, nvs_cache->dirty_count + committed);
+        /* Whatever started the commit, the timer retries the entries left dirty */
+        if (nvs_cache->commit_timer && nvs_cache->dirty_count > 0)
+        {
+            ESP_LOGW(NVS_CACHE_TAG, "Retrying in %" PRIu32 " ms", nvs_cache->commit_interval_ms);
+            esp_timer_start_once(nvs_cache->commit_timer, (uint64_t)nvs_cache->commit_interval_ms * 1000);
+        }
+        return err;
+    }
+
+    int64_t latency_us = esp_timer_get_time() - start_us;
+    nvs_cache->stats.commit_count++;
+    nvs_cache->stats.committed_entry_count += committed;
+    nvs_cache->stats.last_commit_latency_us = latency_us;
+    nvs_cache->stats.total_commit_latency_us += latency_us;
+    if (latency_us > nvs_cache->stats.max_commit_latency_us)
+        nvs_cache->stats.max_commit_latency_us = latency_us;
+    ESP_LOGD(NVS_CACHE_TAG, "Committed %u entries in %" PRId64 " us", committed, latency_us);
+
+    return err;
+}
+
+/* Flash writes do not belong in the esp_timer task or in the caller of
+ * nvs_cache_set, so both only wake the commit task */
+static void nvs_cache_commit_timer_cb(void *arg)
+{
+    nvs_cache_handle_t *nvs_cache = (nvs_cache_handle_t *)arg;
+    xTaskNotifyGive(nvs_cache->commit_task);
+}
+
+static void nvs_cache_commit_task(void *arg)
+{
+    nvs_cache_handle_t *nvs_cache = (nvs_cache_handle_t *)arg;
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        xSemaphoreTake(nvs_cache->mutex, portMAX_DELAY);
+        nvs_cache_commit_locked(nvs_cache);
+        xSemaphoreGive(nvs_cache->mutex);
+    }
+}
+
+static esp_err_t nvs_cache_set(nvs_cache_handle_t *nvs_cache, const char *key, nvs_cache_type_t type, const void *value, size_t length)
+{
+    if (strlen(key) >= NVS_KEY_NAME_MAX_SIZE)
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    if (length > NVS_CACHE_MAX_VALUE_SIZE)
+        return ESP_ERR_NVS_INVALID_LENGTH;
+
+    xSemaphoreTake(nvs_cache->mutex, portMAX_DELAY);
+    nvs_cache->stats.write_count++;
+    nvs_cache_entry_t *entry = nvs_cache_find(nvs_cache, key);
+    if (entry && entry->type != type)
+    {
+        xSemaphoreGive(nvs_cache->mutex);
+        ESP_LOGE(NVS_CACHE_TAG, "Key \"%s\" is cached with a different type", key);
+        return ESP_ERR_NVS_TYPE_MISMATCH;
+    }
+    if (entry && entry->length == length && memcmp(entry->value, value, length) == 0)
+    {
+        nvs_cache->stats.skipped_write_count++;
+        xSemaphoreGive(nvs_cache->mutex);
+        return ESP_OK;
+    }
+    if (!entry)
+        entry = nvs_cache_alloc(nvs_cache, key, type);
+    if (!entry)
+    {
+        xSemaphoreGive(nvs_cache->mutex);
+        ESP_LOGE(NVS_CACHE_TAG, "No free cache entry for key \"%s\"", key);
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(entry->value, value, length);
+    entry->length = length;
+    if (!entry->dirty)
+    {
+        entry->dirty = true;
+        nvs_cache->dirty_count++;
+    }
+
+    /* The value is in RAM from here on; writing it to flash is left to the commit task */
+    if (nvs_cache->commit_threshold && nvs_cache->dirty_count >= nvs_cache->commit_threshold)
+        xTaskNotifyGive(nvs_cache->commit_task);
+    else if (nvs_cache->commit_timer && !esp_timer_is_active(nvs_cache->commit_timer) &&
+             esp_timer_start_once(nvs_cache->commit_timer, (uint64_t)nvs_cache->commit_interval_ms * 1000) != ESP_OK)
+        ESP_LOGE(NVS_CACHE_TAG, "Failed to start commit timer");
+    xSemaphoreGive(nvs_cache->mutex);
+
+    return ESP_OK;
+}
+
+/* For keys the cache has no room for: values larger than NVS_CACHE_MAX_VALUE_SIZE
+ * or keys beyond NVS_CACHE_MAX_ENTRIES */
+static esp_err_t nvs_cache_read_direct(nvs_cache_handle_t *nvs_cache, const char *key, nvs_cache_type_t type, void *value, size_t *length)
+{
+    switch (type)
+    {
+    case NVS_CACHE_TYPE_U32:
+        return nvs_get_u32(nvs_cache->nvs_handle, key, (uint32_t *)value);
+    case NVS_CACHE_TYPE_I32:
+        return nvs_get_i32(nvs_cache->nvs_handle, key, (int32_t *)value);
+    case NVS_CACHE_TYPE_STR:
+        return nvs_get_str(nvs_cache->nvs_handle, key, (char *)value, length);
+    case NVS_CACHE_TYPE_BLOB:
+        return nvs_get_blob(nvs_cache->nvs_handle, key, value, length);
+    default:
+        return ESP_ERR_NVS_TYPE_MISMATCH;
+    }
+}
+
+static esp_err_t nvs_cache_get(nvs_cache_handle_t *nvs_cache, const char *key, nvs_cache_type_t type, void *value, size_t *length)
+{
+    xSemaphoreTake(nvs_cache->mutex, portMAX_DELAY);
+    nvs_cache_entry_t *entry = nvs_cache_find(nvs_cache, key);
+    esp_err_t err = ESP_OK;
+    if (!entry && nvs_cache->complete)
+        err = ESP_ERR_NVS_NOT_FOUND;
+    else if (!entry)
+    {
+        if ((entry = nvs_cache_alloc(nvs_cache, key, type)) && (err = nvs_cache_read_entry(nvs_cache, entry)) != ESP_OK)
+            entry->used = false;
+        if (!entry || err == ESP_ERR_NVS_INVALID_LENGTH)
+        {
+            err = nvs_cache_read_direct(nvs_cache, key, type, value, length);
+            xSemaphoreGive(nvs_cache->mutex);
+            return err;
+        }
+    }
+    if (err == ESP_OK && entry->type != type)
+        err = ESP_ERR_NVS_TYPE_MISMATCH;
+    if (err == ESP_OK)
+    {
+        if (!length)
+            memcpy(value, entry->value, entry->length);
+        else if (!value)
+            *length = entry->length;
+        else if (*length < entry->length)
+            err = ESP_ERR_NVS_INVALID_LENGTH;
+        else
+        {
+            memcpy(value, entry->value, entry->length);
+            *length = entry->length;
+        }
+    }
+    xSemaphoreGive(nvs_cache->mutex);
+
+    return err;
+}
+
+esp_err_t nvs_cache_init(nvs_cache_handle_t *nvs_cache, nvs_cache_config_t nvs_cache_config)
+{
+    ESP_LOGI(NVS_CACHE_TAG, "Initializing NVS cache for namespace \"%s\"...", nvs_cache_config.namespace_name);
+    memset(nvs_cache, 0, sizeof(*nvs_cache));
+    nvs_cache->commit_interval_ms = nvs_cache_config.commit_interval_ms;
+    nvs_cache->commit_threshold = nvs_cache_config.commit_threshold;
+    esp_err_t err = nvs_open(nvs_cache_config.namespace_name, NVS_READWRITE, &nvs_cache->nvs_handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(NVS_CACHE_TAG, "Failed to open namespace");
+        return err;
+    }
+    nvs_cache->mutex = xSemaphoreCreateMutex();
+    if (!nvs_cache->mutex)
+    {
+        ESP_LOGE(NVS_CACHE_TAG, "Failed to create mutex");
+        nvs_close(nvs_cache->nvs_handle);
+        return ESP_ERR_NO_MEM;
+    }
+    if ((nvs_cache->commit_interval_ms || nvs_cache->commit_threshold) &&
+        xTaskCreate(nvs_cache_commit_task, "nvs_cache_commit", NVS_CACHE_TASK_STACK_SIZE, nvs_cache, NVS_CACHE_TASK_PRIORITY, &nvs_cache->commit_task) != pdPASS)
+    {
+        ESP_LOGE(NVS_CACHE_TAG, "Failed to create commit task");
+        vSemaphoreDelete(nvs_cache->mutex);
+        nvs_close(nvs_cache->nvs_handle);
+        return ESP_ERR_NO_MEM;
+    }
+    if (nvs_cache->commit_interval_ms)
+    {
+        const esp_timer_create_args_t commit_timer_args = {
+            .callback = nvs_cache_commit_timer_cb,
+            .arg = nvs_cache,
+            .name = "nvs_cache_commit"};
+        err = esp_timer_create(&commit_timer_args, &nvs_cache->commit_timer);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(NVS_CACHE_TAG, "Failed to create commit timer");
+            vTaskDelete(nvs_cache->commit_task);
+            vSemaphoreDelete(nvs_cache->mutex);
+            nvs_close(nvs_cache->nvs_handle);
+            return err;
+        }
+    }
+    err = nvs_cache_preload(nvs_cache, nvs_cache_config.namespace_name);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(NVS_CACHE_TAG, "Failed to load namespace");
+        nvs_cache_deinit(nvs_cache);
+        return err;
+    }
+    ESP_LOGI(NVS_CACHE_TAG, "NVS cache initialized successfully");
+
+    return err;
+}
+
+esp_err_t nvs_cache_set_u32(nvs_cache_handle_t *nvs_cache, const char *key, uint32_t value)
+{
+    return nvs_cache_set(nvs_cache, key, NVS_CACHE_TYPE_U32, &value, sizeof(value));
+}
+
+esp_err_t nvs_cache_get_u32(nvs_cache_handle_t *nvs_cache, const char *key, uint32_t *value)
+{
+    return nvs_cache_get(nvs_cache, key, NVS_CACHE_TYPE_U32, value, NULL);
+}
+
+esp_err_t nvs_cache_set_i32(nvs_cache_handle_t *nvs_cache, const char *key, int32_t value)
+{
+    return nvs_cache_set(nvs_cache, key, NVS_CACHE_TYPE_I32, &value, sizeof(value));
+}
+
+esp_err_t nvs_cache_get_i32(nvs_cache_handle_t *nvs_cache, const char *key, int32_t *value)
+{
+    return nvs_cache_get(nvs_cache, key, NVS_CACHE_TYPE_I32, value, NULL);
+}
+
+esp_err_t nvs_cache_set_str(nvs_cache_handle_t *nvs_cache, const char *key, const char *value)
+{
+    return nvs_cache_set(nvs_cache, key, NVS_CACHE_TYPE_STR, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_cache_get_str(nvs_cache_handle_t *nvs_cache, const char *key, char *value, size_t *length)
+{
+    return nvs_cache_get(nvs_cache, key, NVS_CACHE_TYPE_STR, value, length);
+}
+
+esp_err_t nvs_cache_set_blob(nvs_cache_handle_t *nvs_cache, const char *key, const void *value, size_t length)
+{
+    return nvs_cache_set(nvs_cache, key, NVS_CACHE_TYPE_BLOB, value, length);
+}
+
+esp_err_t nvs_cache_get_blob(nvs_cache_handle_t *nvs_cache, const char *key, void *value, size_t *length)
+{
+    return nvs_cache_get(nvs_cache, key, NVS_CACHE_TYPE_BLOB, value, length);
+}
+
+esp_err_t nvs_cache_commit(nvs_cache_handle_t *nvs_cache)
+{
+    xSemaphoreTake(nvs_cache->mutex, portMAX_DELAY);
+    esp_err_t err = nvs_cache_commit_locked(nvs_cache);
+    xSemaphoreGive(nvs_cache->mutex);
+
+    return err;
+}
+
+void nvs_cache_get_stats(nvs_cache_handle_t *nvs_cache, nvs_cache_stats_t *stats)
+{
+    xSemaphoreTake(nvs_cache->mutex, portMAX_DELAY);
+    *stats = nvs_cache->stats;
+    xSemaphoreGive(nvs_cache->mutex);
+}
+
+esp_err_t nvs_cache_deinit(nvs_cache_handle_t *nvs_cache)
+{
+    ESP_LOGI(NVS_CACHE_TAG, "Deinitializing NVS cache");
+    esp_err_t err = nvs_cache_commit(nvs_cache);
+    if (err != ESP_OK)
+        ESP_LOGE(NVS_CACHE_TAG, "Failed to commit pending entries, discarding them");
+    if (nvs_cache->commit_timer)
+    {
+        esp_timer_stop(nvs_cache->commit_timer);
+        esp_timer_delete(nvs_cache->commit_timer);
+        nvs_cache->commit_timer = NULL;
+    }
+    /* Holding the mutex guarantees the task is not halfway through a commit */
+    xSemaphoreTake(nvs_cache->mutex, portMAX_DELAY);
+    if (nvs_cache->commit_task)
+    {
+        vTaskDelete(nvs_cache->commit_task);
+        nvs_cache->commit_task = NULL;
+    }
+    xSemaphoreGive(nvs_cache->mutex);
+    nvs_close(nvs_cache->nvs_handle);
+    vSemaphoreDelete(nvs_cache->mutex);
+    nvs_cache->mutex = NULL;
+    if (err == ESP_OK)
+        ESP_LOGI(NVS_CACHE_TAG, "NVS cache deinitialized successfully");
+
+    return err;
+}
+
 /* WIFI STATION MODE */
 void wifi_event_handler_cb(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
 {
@@ -280,10 +811,548 @@ static const char *get_client_content_type(content_type_t type)
     }
 }
 
+typedef enum
+{
+    HTTPX_JSON_STATE_VALUE,
+    HTTPX_JSON_STATE_ARRAY_START,
+    HTTPX_JSON_STATE_OBJECT_START,
+    HTTPX_JSON_STATE_KEY,
+    HTTPX_JSON_STATE_COLON,
+    HTTPX_JSON_STATE_STRING,
+    HTTPX_JSON_STATE_ESCAPE,
+    HTTPX_JSON_STATE_UNICODE,
+    HTTPX_JSON_STATE_SCALAR,
+    HTTPX_JSON_STATE_AFTER_VALUE,
+    HTTPX_JSON_STATE_DONE,
+    HTTPX_JSON_STATE_ERROR
+} httpx_json_state_t;
+
+typedef enum
+{
+    HTTPX_JSON_NUMBER_START,
+    HTTPX_JSON_NUMBER_MINUS,
+    HTTPX_JSON_NUMBER_ZERO,
+    HTTPX_JSON_NUMBER_INTEGER,
+    HTTPX_JSON_NUMBER_POINT,
+    HTTPX_JSON_NUMBER_FRACTION,
+    HTTPX_JSON_NUMBER_EXPONENT,
+    HTTPX_JSON_NUMBER_EXPONENT_SIGN,
+    HTTPX_JSON_NUMBER_EXPONENT_DIGITS,
+    HTTPX_JSON_NUMBER_INVALID
+} httpx_json_number_state_t;
+
+void httpx_json_parser_init(httpx_json_parser_t *parser, httpx_json_field_t *fields, size_t field_count)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->fields = fields;
+    parser->field_count = field_count;
+    parser->state = HTTPX_JSON_STATE_VALUE;
+    for (size_t i = 0; i < field_count; i++)
+        fields[i].found = false;
+}
+
+static bool httpx_json_is_array(const httpx_json_parser_t *parser, uint16_t depth)
+{
+    return parser->arrays[depth / 8] & (1 << (depth % 8));
+}
+
+/* Paths are keys separated by '.' with array indexes in brackets, e.g. "result.chat.id" or "result[0].text" */
+static bool httpx_json_path_match(const httpx_json_parser_t *parser, const char *path)
+{
+    if (parser->depth > HTTPX_JSON_MAX_DEPTH)
+        return false;
+    const char *p = path;
+    for (uint16_t i = 0; i < parser->depth; i++)
+    {
+        const httpx_json_level_t *level = &parser->levels[i];
+        if (httpx_json_is_array(parser, i))
+        {
+            if (*p++ != '[')
+                return false;
+            /* Plain decimal digits only, without sign, spaces or leading zeros */
+            if (*p < '0' || *p > '9' || (p[0] == '0' && p[1] != ']'))
+                return false;
+            uint64_t index = 0;
+            while (*p >= '0' && *p <= '9' && index <= UINT32_MAX)
+                index = index * 10 + (*p++ - '0');
+            if (*p++ != ']' || index != level->index)
+                return false;
+        }
+        else
+        {
+            if (i > 0 && *p++ != '.')
+                return false;
+            size_t key_length = strlen(level->key);
+            if (level->key_truncated || strncmp(p, level->key, key_length) != 0)
+                return false;
+            p += key_length;
+            if (*p != '\0' && *p != '.' && *p != '[')
+                return false;
+        }
+    }
+    return *p == '\0';
+}
+
+static httpx_json_field_t *httpx_json_find_field(const httpx_json_parser_t *parser)
+{
+    for (size_t i = 0; i < parser->field_count; i++)
+    {
+        if (!parser->fields[i].found && httpx_json_path_match(parser, parser->fields[i].path))
+            return &parser->fields[i];
+    }
+    return NULL;
+}
+
+/* Below HTTPX_JSON_MAX_DEPTH only the container type is kept, which is all that is
+ * needed to check the structure while skipping the value */
+static bool httpx_json_push(httpx_json_parser_t *parser, bool is_array)
+{
+    if (parser->depth >= HTTPX_JSON_MAX_NESTING)
+    {
+        ESP_LOGE(HTTPX_CLIENT_TAG, "JSON nesting deeper than %d levels", HTTPX_JSON_MAX_NESTING);
+        return false;
+    }
+    if (is_array)
+        parser->arrays[parser->depth / 8] |= 1 << (parser->depth % 8);
+    else
+        parser->arrays[parser->depth / 8] &= ~(1 << (parser->depth % 8));
+    if (parser->depth < HTTPX_JSON_MAX_DEPTH)
+        memset(&parser->levels[parser->depth], 0, sizeof(parser->levels[0]));
+    parser->depth++;
+    return true;
+}
+
+static void httpx_json_append(httpx_json_parser_t *parser, char c)
+{
+    if (parser->in_key)
+    {
+        if (parser->depth > HTTPX_JSON_MAX_DEPTH)
+            return;
+        httpx_json_level_t *level = &parser->levels[parser->depth - 1];
+        if (parser->key_length < sizeof(level->key) - 1)
+            level->key[parser->key_length++] = c;
+        else
+            level->key_truncated = true;
+    }
+    else if (parser->capture && parser->capture->type == HTTPX_JSON_TYPE_STRING)
+    {
+        if (parser->capture_length + 1 < parser->capture->value_size)
+            ((char *)parser->capture->value)[parser->capture_length++] = c;
+    }
+}
+
+static void httpx_json_append_utf8(httpx_json_parser_t *parser, uint32_t code_point)
+{
+    if (code_point < 0x80)
+        httpx_json_append(parser, (char)code_point);
+    else if (code_point < 0x800)
+    {
+        httpx_json_append(parser, (char)(0xC0 | (code_point >> 6)));
+        httpx_json_append(parser, (char)(0x80 | (code_point & 0x3F)));
+    }
+    else if (code_point < 0x10000)
+    {
+        httpx_json_append(parser, (char)(0xE0 | (code_point >> 12)));
+        httpx_json_append(parser, (char)(0x80 | ((code_point >> 6) & 0x3F)));
+        httpx_json_append(parser, (char)(0x80 | (code_point & 0x3F)));
+    }
+    else
+    {
+        httpx_json_append(parser, (char)(0xF0 | (code_point >> 18)));
+        httpx_json_append(parser, (char)(0x80 | ((code_point >> 12) & 0x3F)));
+        httpx_json_append(parser, (char)(0x80 | ((code_point >> 6) & 0x3F)));
+        httpx_json_append(parser, (char)(0x80 | (code_point & 0x3F)));
+    }
+}
+
+/* A high surrogate not followed by a \u low surrogate is replaced by U+FFFD */
+static void httpx_json_flush_surrogate(httpx_json_parser_t *parser)
+{
+    if (parser->high_surrogate)
+    {
+        parser->high_surrogate = 0;
+        httpx_json_append_utf8(parser, 0xFFFD);
+    }
+}
+
+static void httpx_json_unicode(httpx_json_parser_t *parser, uint32_t code_point)
+{
+    if (code_point >= 0xD800 && code_point <= 0xDBFF)
+    {
+        httpx_json_flush_surrogate(parser);
+        parser->high_surrogate = code_point;
+        return;
+    }
+    if (code_point >= 0xDC00 && code_point <= 0xDFFF)
+    {
+        if (!parser->high_surrogate)
+            code_point = 0xFFFD;
+        else
+            code_point = 0x10000 + ((parser->high_surrogate - 0xD800) << 10) + (code_point - 0xDC00);
+        parser->high_surrogate = 0;
+    }
+    httpx_json_flush_surrogate(parser);
+    httpx_json_append_utf8(parser, code_point);
+}
+
+static void httpx_json_end_string(httpx_json_parser_t *parser)
+{
+    if (parser->in_key)
+    {
+        if (parser->depth <= HTTPX_JSON_MAX_DEPTH)
+            parser->levels[parser->depth - 1].key[parser->key_length] = '\0';
+        parser->in_key = false;
+        parser->state = HTTPX_JSON_STATE_COLON;
+        return;
+    }
+    httpx_json_field_t *field = parser->capture;
+    if (field && field->type == HTTPX_JSON_TYPE_STRING && field->value_size > 0)
+    {
+        ((char *)field->value)[parser->capture_length] = '\0';
+        field->found = true;
+    }
+    parser->capture = NULL;
+    parser->state = HTTPX_JSON_STATE_AFTER_VALUE;
+}
+
+/* Tracks the JSON number grammar -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)? one character at a time */
+static uint8_t httpx_json_number_step(uint8_t state, char c)
+{
+    bool digit = c >= '0' && c <= '9';
+    switch (state)
+    {
+    case HTTPX_JSON_NUMBER_START:
+        if (c == '-')
+            return HTTPX_JSON_NUMBER_MINUS;
+        /* fall through */
+    case HTTPX_JSON_NUMBER_MINUS:
+        if (c == '0')
+            return HTTPX_JSON_NUMBER_ZERO;
+        return digit ? HTTPX_JSON_NUMBER_INTEGER : HTTPX_JSON_NUMBER_INVALID;
+    case HTTPX_JSON_NUMBER_INTEGER:
+        if (digit)
+            return HTTPX_JSON_NUMBER_INTEGER;
+        /* fall through */
+    case HTTPX_JSON_NUMBER_ZERO:
+        if (c == '.')
+            return HTTPX_JSON_NUMBER_POINT;
+        return c == 'e' || c == 'E' ? HTTPX_JSON_NUMBER_EXPONENT : HTTPX_JSON_NUMBER_INVALID;
+    case HTTPX_JSON_NUMBER_POINT:
+    case HTTPX_JSON_NUMBER_FRACTION:
+        if (digit)
+            return HTTPX_JSON_NUMBER_FRACTION;
+        if (state == HTTPX_JSON_NUMBER_FRACTION && (c == 'e' || c == 'E'))
+            return HTTPX_JSON_NUMBER_EXPONENT;
+        return HTTPX_JSON_NUMBER_INVALID;
+    case HTTPX_JSON_NUMBER_EXPONENT:
+        if (c == '+' || c == '-')
+            return HTTPX_JSON_NUMBER_EXPONENT_SIGN;
+        /* fall through */
+    case HTTPX_JSON_NUMBER_EXPONENT_SIGN:
+    case HTTPX_JSON_NUMBER_EXPONENT_DIGITS:
+        return digit ? HTTPX_JSON_NUMBER_EXPONENT_DIGITS : HTTPX_JSON_NUMBER_INVALID;
+    default:
+        return HTTPX_JSON_NUMBER_INVALID;
+    }
+}
+
+static bool httpx_json_end_scalar(httpx_json_parser_t *parser)
+{
+    httpx_json_field_t *field = parser->capture;
+    parser->capture = NULL;
+    parser->state = HTTPX_JSON_STATE_AFTER_VALUE;
+
+    uint8_t number_state = parser->number_state;
+    bool is_number = number_state == HTTPX_JSON_NUMBER_ZERO || number_state == HTTPX_JSON_NUMBER_INTEGER ||
+                     number_state == HTTPX_JSON_NUMBER_FRACTION || number_state == HTTPX_JSON_NUMBER_EXPONENT_DIGITS;
+    /* A number too long for the buffer is valid but can not be converted */
+    if (parser->scalar_length >= sizeof(parser->scalar))
+    {
+        if (!is_number)
+            ESP_LOGE(HTTPX_CLIENT_TAG, "Invalid JSON literal");
+        return is_number;
+    }
+    parser->scalar[parser->scalar_length] = '\0';
+
+    const char *scalar = parser->scalar;
+    bool is_bool = strcmp(scalar, "true") == 0 || strcmp(scalar, "false") == 0;
+    if (!is_bool && !is_number && strcmp(scalar, "null") != 0)
+    {
+        ESP_LOGE(HTTPX_CLIENT_TAG, "Invalid JSON literal: %s", scalar);
+        return false;
+    }
+    if (!field)
+        return true;
+
+    char *end;
+    switch (field->type)
+    {
+    case HTTPX_JSON_TYPE_STRING:
+        if (field->value_size > parser->scalar_length)
+        {
+            memcpy(field->value, scalar, parser->scalar_length + 1);
+            field->found = true;
+        }
+        break;
+    case HTTPX_JSON_TYPE_INT:
+        if (is_number)
+        {
+            errno = 0;
+            long long integer = strtoll(scalar, &end, 10);
+            if (*end == '\0' && errno != ERANGE)
+            {
+                *(int64_t *)field->value = integer;
+                field->found = true;
+            }
+        }
+        break;
+    case HTTPX_JSON_TYPE_DOUBLE:
+        if (is_number)
+        {
+            errno = 0;
+            double number = strtod(scalar, &end);
+            if (errno != ERANGE || (number != HUGE_VAL && number != -HUGE_VAL))
+            {
+                *(double *)field->value = number;
+                field->found = true;
+            }
+        }
+        break;
+    case HTTPX_JSON_TYPE_BOOL:
+        if (is_bool)
+        {
+            *(bool *)field->value = scalar[0] == 't';
+            field->found = true;
+        }
+        break;
+    }
+
+    return true;
+}
+
+static bool httpx_json_is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/* Returns false when the character has to be processed again in the new state */
+static bool httpx_json_step(httpx_json_parser_t *parser, char c)
+{
+    switch (parser->state)
+    {
+    case HTTPX_JSON_STATE_ARRAY_START:
+        if (httpx_json_is_space(c))
+            return true;
+        if (c == ']')
+        {
+            parser->depth--;
+            parser->state = HTTPX_JSON_STATE_AFTER_VALUE;
+            return true;
+        }
+        parser->state = HTTPX_JSON_STATE_VALUE;
+        return false;
+    case HTTPX_JSON_STATE_VALUE:
+        if (httpx_json_is_space(c))
+            return true;
+        parser->capture = httpx_json_find_field(parser);
+        if (c == '{' || c == '[')
+        {
+            parser->capture = NULL;
+            parser->state = c == '{' ? HTTPX_JSON_STATE_OBJECT_START : HTTPX_JSON_STATE_ARRAY_START;
+            if (!httpx_json_push(parser, c == '['))
+                parser->state = HTTPX_JSON_STATE_ERROR;
+        }
+        else if (c == '"')
+        {
+            parser->in_key = false;
+            parser->capture_length = 0;
+            parser->high_surrogate = 0;
+            parser->state = HTTPX_JSON_STATE_STRING;
+        }
+        else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n')
+        {
+            parser->scalar_length = 0;
+            parser->number_state = HTTPX_JSON_NUMBER_START;
+            parser->state = HTTPX_JSON_STATE_SCALAR;
+            return false;
+        }
+        else
+            parser->state = HTTPX_JSON_STATE_ERROR;
+        return true;
+    case HTTPX_JSON_STATE_OBJECT_START:
+    case HTTPX_JSON_STATE_KEY:
+        if (httpx_json_is_space(c))
+            return true;
+        if (c == '}' && parser->state == HTTPX_JSON_STATE_OBJECT_START)
+        {
+            parser->depth--;
+            parser->state = HTTPX_JSON_STATE_AFTER_VALUE;
+        }
+        else if (c == '"')
+        {
+            if (parser->depth <= HTTPX_JSON_MAX_DEPTH)
+                parser->levels[parser->depth - 1].key_truncated = false;
+            parser->key_length = 0;
+            parser->high_surrogate = 0;
+            parser->in_key = true;
+            parser->state = HTTPX_JSON_STATE_STRING;
+        }
+        else
+            parser->state = HTTPX_JSON_STATE_ERROR;
+        return true;
+    case HTTPX_JSON_STATE_COLON:
+        if (httpx_json_is_space(c))
+            return true;
+        parser->state = c == ':' ? HTTPX_JSON_STATE_VALUE : HTTPX_JSON_STATE_ERROR;
+        return true;
+    case HTTPX_JSON_STATE_STRING:
+        if (c == '\\')
+        {
+            parser->state = HTTPX_JSON_STATE_ESCAPE;
+            return true;
+        }
+        httpx_json_flush_surrogate(parser);
+        if (c == '"')
+            httpx_json_end_string(parser);
+        else if ((unsigned char)c < 0x20)
+            parser->state = HTTPX_JSON_STATE_ERROR;
+        else
+            httpx_json_append(parser, c);
+        return true;
+    case HTTPX_JSON_STATE_ESCAPE:
+        parser->state = HTTPX_JSON_STATE_STRING;
+        if (c != 'u')
+            httpx_json_flush_surrogate(parser);
+        switch (c)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            httpx_json_append(parser, c);
+            break;
+        case 'b':
+            httpx_json_append(parser, '\b');
+            break;
+        case 'f':
+            httpx_json_append(parser, '\f');
+            break;
+        case 'n':
+            httpx_json_append(parser, '\n');
+            break;
+        case 'r':
+            httpx_json_append(parser, '\r');
+            break;
+        case 't':
+            httpx_json_append(parser, '\t');
+            break;
+        case 'u':
+            parser->unicode = 0;
+            parser->unicode_digits = 0;
+            parser->state = HTTPX_JSON_STATE_UNICODE;
+            break;
+        default:
+            parser->state = HTTPX_JSON_STATE_ERROR;
+            break;
+        }
+        return true;
+    case HTTPX_JSON_STATE_UNICODE:
+        if (c >= '0' && c <= '9')
+            parser->unicode = (parser->unicode << 4) | (c - '0');
+        else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+            parser->unicode = (parser->unicode << 4) | ((c | 0x20) - 'a' + 10);
+        else
+        {
+            parser->state = HTTPX_JSON_STATE_ERROR;
+            return true;
+        }
+        if (++parser->unicode_digits == 4)
+        {
+            httpx_json_unicode(parser, parser->unicode);
+            parser->state = HTTPX_JSON_STATE_STRING;
+        }
+        return true;
+    case HTTPX_JSON_STATE_SCALAR:
+        if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '-' || c == '+' || c == '.')
+        {
+            if (parser->scalar_length < sizeof(parser->scalar))
+                parser->scalar[parser->scalar_length++] = c;
+            parser->number_state = httpx_json_number_step(parser->number_state, c);
+            return true;
+        }
+        if (!httpx_json_end_scalar(parser))
+            parser->state = HTTPX_JSON_STATE_ERROR;
+        return false;
+    case HTTPX_JSON_STATE_AFTER_VALUE:
+    {
+        if (parser->depth == 0)
+        {
+            parser->state = HTTPX_JSON_STATE_DONE;
+            return false;
+        }
+        if (httpx_json_is_space(c))
+            return true;
+        bool is_array = httpx_json_is_array(parser, parser->depth - 1);
+        if (c == ',')
+        {
+            if (is_array && parser->depth <= HTTPX_JSON_MAX_DEPTH)
+                parser->levels[parser->depth - 1].index++;
+            parser->state = is_array ? HTTPX_JSON_STATE_VALUE : HTTPX_JSON_STATE_KEY;
+        }
+        else if ((c == ']' && is_array) || (c == '}' && !is_array))
+            parser->depth--;
+        else
+            parser->state = HTTPX_JSON_STATE_ERROR;
+        return true;
+    }
+    case HTTPX_JSON_STATE_DONE:
+        if (!httpx_json_is_space(c))
+            parser->state = HTTPX_JSON_STATE_ERROR;
+        return true;
+    default:
+        return true;
+    }
+}
+
+esp_err_t httpx_json_parser_feed(httpx_json_parser_t *parser, const char *data, size_t length)
+{
+    if (parser->state == HTTPX_JSON_STATE_ERROR)
+        return ESP_ERR_INVALID_RESPONSE;
+
+    size_t i = 0;
+    while (i < length && parser->state != HTTPX_JSON_STATE_ERROR)
+    {
+        if (httpx_json_step(parser, data[i]))
+            i++;
+    }
+    if (parser->state == HTTPX_JSON_STATE_ERROR)
+    {
+        ESP_LOGE(HTTPX_CLIENT_TAG, "Invalid JSON response");
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t httpx_json_parser_finish(httpx_json_parser_t *parser)
+{
+    if (parser->state == HTTPX_JSON_STATE_SCALAR && !httpx_json_end_scalar(parser))
+        parser->state = HTTPX_JSON_STATE_ERROR;
+    if (parser->state == HTTPX_JSON_STATE_AFTER_VALUE && parser->depth == 0)
+        parser->state = HTTPX_JSON_STATE_DONE;
+    if (parser->state != HTTPX_JSON_STATE_DONE)
+    {
+        ESP_LOGE(HTTPX_CLIENT_TAG, "Incomplete or invalid JSON response");
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    return ESP_OK;
+}
+
 static esp_err_t http_response_init(httpx_client_response_t *response)
 {
     response->buffer = NULL;
     response->length = 0;
+    response->json_parser = NULL;
     return ESP_OK;
 }
 
@@ -316,6 +1385,14 @@ static esp_err_t httpx_event_handler(esp_http_client_event_t *evt)
         if (!evt->data || evt->data_len == 0)
             break;
 
+        if (response->json_parser)
+        {
+            /* The parser keeps the error, so httpx_json_parser_finish reports it too */
+            if (httpx_json_parser_feed(response->json_parser, evt->data, evt->data_len) != ESP_OK)
+                return ESP_FAIL;
+            break;
+        }
+
         size_t new_length = response->length + evt->data_len;
         char *new_buffer = realloc(response->buffer, new_length + 1);
 
@@ -351,9 +1428,11 @@ static esp_err_t httpx_event_handler(esp_http_client_event_t *evt)
     return ESP_OK;
 }
 
-esp_err_t httpx_rest_url_data(char *url, esp_http_client_method_t method, const char *cert_pem, const void *send_data, size_t data_size, content_type_t content_type)
+static esp_err_t httpx_rest_url_perform(char *url, esp_http_client_method_t method, const char *cert_pem, const void *send_data, size_t data_size, content_type_t content_type, httpx_json_parser_t *json_parser)
 {
-    httpx_client_response_t response = {0};
+    httpx_client_response_t response;
+    http_response_init(&response);
+    response.json_parser = json_parser;
 
     esp_http_client_config_t config = {
         .url = url,
@@ -391,7 +1470,10 @@ esp_err_t httpx_rest_url_data(char *url, esp_http_client_method_t method, const
     if (err == ESP_OK)
     {
         ESP_LOGI(HTTPX_CLIENT_TAG, "Status: %d (%" PRId64 " bytes)", esp_http_client_get_status_code(client), esp_http_client_get_content_length(client));
-        ESP_LOGI(HTTPX_CLIENT_TAG, "Response (%zu bytes):\n%s", response.length, response.buffer);
+        if (json_parser)
+            err = httpx_json_parser_finish(json_parser);
+        else
+            ESP_LOGI(HTTPX_CLIENT_TAG, "Response (%zu bytes):\n%s", response.length, response.buffer);
     }
     else
     {
@@ -404,6 +1486,26 @@ esp_err_t httpx_rest_url_data(char *url, esp_http_client_method_t method, const
     return err;
 }
 
+esp_err_t httpx_rest_url_data(char *url, esp_http_client_method_t method, const char *cert_pem, const void *send_data, size_t data_size, content_type_t content_type)
+{
+    return httpx_rest_url_perform(url, method, cert_pem, send_data, data_size, content_type, NULL);
+}
+
+esp_err_t httpx_rest_url_data_json(char *url, esp_http_client_method_t method, const char *cert_pem, const void *send_data, size_t data_size, content_type_t content_type, httpx_json_field_t *fields, size_t field_count)
+{
+    httpx_json_parser_t json_parser;
+    httpx_json_parser_init(&json_parser, fields, field_count);
+
+    esp_err_t err = httpx_rest_url_perform(url, method, cert_pem, send_data, data_size, content_type, &json_parser);
+    if (err != ESP_OK)
+    {
+        for (size_t i = 0; i < field_count; i++)
+            fields[i].found = false;
+    }
+
+    return err;
+}
+
 /* HTTPS SERVER */
 typedef struct
 {
@@ -459,6 +1561,8 @@ static void httpx_close_handler(httpd_handle_t hd, int sockfd)
     get_client_address(sockfd, &client_info);
 
     ESP_LOGI(HTTP_SERVER_TAG, "Client disconnected: socket=%d, IP=%s, port=%s", sockfd, client_info.ip, client_info.port);
+    /* The server leaves closing the socket to close_fn when one is set */
+    close(sockfd);
 }
 
 esp_err_t http_server_start(httpd_handle_t *httpd_server)
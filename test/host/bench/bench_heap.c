@@ -0,0 +1,135 @@
+#include <stdatomic.h>
+#include <stddef.h>
+#include <errno.h>
+#include <malloc.h>
+#include "bench_heap.h"
+
+/* Replaces the glibc allocator entry points to count allocations and live
+ * bytes, both per thread and for the whole process */
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+static __thread uint64_t thread_allocs;
+static __thread int64_t thread_live;
+static __thread int64_t thread_peak;
+static __thread int64_t thread_base;
+
+static atomic_uint_fast64_t process_allocs;
+static atomic_int_fast64_t process_live;
+static atomic_int_fast64_t process_peak;
+static int64_t process_base;
+static uint64_t process_allocs_base;
+
+static void account_alloc(void *ptr)
+{
+    if (!ptr)
+        return;
+    int64_t size = (int64_t)malloc_usable_size(ptr);
+    thread_allocs++;
+    thread_live += size;
+    if (thread_live > thread_peak)
+        thread_peak = thread_live;
+    atomic_fetch_add(&process_allocs, 1);
+    int64_t live = atomic_fetch_add(&process_live, size) + size;
+    int64_t peak = atomic_load(&process_peak);
+    while (live > peak && !atomic_compare_exchange_weak(&process_peak, &peak, live))
+        ;
+}
+
+static void account_free(void *ptr)
+{
+    if (!ptr)
+        return;
+    int64_t size = (int64_t)malloc_usable_size(ptr);
+    thread_live -= size;
+    atomic_fetch_sub(&process_live, size);
+}
+
+void *malloc(size_t size)
+{
+    void *ptr = __libc_malloc(size);
+    account_alloc(ptr);
+    return ptr;
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    void *ptr = __libc_calloc(nmemb, size);
+    account_alloc(ptr);
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    if (ptr && size == 0)
+    {
+        free(ptr);
+        return NULL;
+    }
+    int64_t old_size = ptr ? (int64_t)malloc_usable_size(ptr) : 0;
+    void *new_ptr = __libc_realloc(ptr, size);
+    if (new_ptr)
+    {
+        thread_live -= old_size;
+        atomic_fetch_sub(&process_live, old_size);
+        account_alloc(new_ptr);
+    }
+    return new_ptr;
+}
+
+void free(void *ptr)
+{
+    account_free(ptr);
+    __libc_free(ptr);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    void *ptr = __libc_memalign(alignment, size);
+    account_alloc(ptr);
+    return ptr;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+    void *ptr = memalign(alignment, size);
+    if (!ptr && size)
+        return ENOMEM;
+    *memptr = ptr;
+    return 0;
+}
+
+void bench_heap_thread_begin(void)
+{
+    thread_allocs = 0;
+    thread_base = thread_live;
+    thread_peak = thread_live;
+}
+
+bench_heap_usage_t bench_heap_thread_end(void)
+{
+    return (bench_heap_usage_t){.allocs = thread_allocs, .peak_bytes = thread_peak - thread_base};
+}
+
+void bench_heap_process_begin(void)
+{
+    process_allocs_base = atomic_load(&process_allocs);
+    process_base = atomic_load(&process_live);
+    atomic_store(&process_peak, process_base);
+}
+
+bench_heap_usage_t bench_heap_process_end(void)
+{
+    return (bench_heap_usage_t){.allocs = atomic_load(&process_allocs) - process_allocs_base, .peak_bytes = atomic_load(&process_peak) - process_base};
+}
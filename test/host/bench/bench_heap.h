@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint64_t allocs;
+    int64_t peak_bytes;
+} bench_heap_usage_t;
+
+/* Allocations made by the calling thread between begin and end */
+void bench_heap_thread_begin(void);
+bench_heap_usage_t bench_heap_thread_end(void);
+
+/* Allocations made by every thread between begin and end */
+void bench_heap_process_begin(void);
+bench_heap_usage_t bench_heap_process_end(void);
@@ -0,0 +1,466 @@
+/* Host benchmark for the HTTPX client and the HTTP/HTTPS server start/stop paths.
+ *
+ * WiFi_utils.c is built against the host implementations of esp_http_client and
+ * esp_http_server in test/host/mocks. The server started by http_server_start()
+ * and https_server_start() doubles as the loopback stand-in that the client
+ * requests are sent to. Allocations are counted by bench_heap.c, per client
+ * thread for requests and process-wide for server start/stop.
+ *
+ * Usage: wifi_utils_bench [--quick] [--requests N] [--csv FILE] [--baseline FILE] [--tolerance PERCENT]
+ *
+ * With --baseline, allocations per request and peak heap are compared with a
+ * CSV written by an earlier --csv run; the exit status is 1 if any of them grew
+ * by more than the tolerance (default 10%). Timings are only reported, they are
+ * too noisy to gate on. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <WiFi_utils.h>
+#include "bench_heap.h"
+
+#define BENCH_TAG "BENCH"
+#define BENCH_MAX_CONCURRENCY 16
+#define BENCH_MAX_RESULTS 128
+#define BENCH_JSON_TEXT_SIZE 32
+
+typedef enum
+{
+    BENCH_API_BUFFERED,
+    BENCH_API_JSON
+} bench_api_t;
+
+typedef struct
+{
+    char name[32];
+    const char *transport;
+    const char *api;
+    size_t body_size;
+    int concurrency;
+    int requests;
+    int errors;
+    double req_per_s;
+    int64_t p50_us;
+    int64_t p90_us;
+    int64_t p99_us;
+    int64_t max_us;
+    double allocs_per_req;
+    int64_t peak_heap_bytes;
+} bench_result_t;
+
+typedef struct
+{
+    char *body;
+    size_t length;
+} bench_payload_t;
+
+typedef struct
+{
+    char *url;
+    const char *cert_pem;
+    bench_api_t api;
+    const bench_payload_t *request;
+    int requests;
+    int64_t *latencies_us;
+    uint64_t allocs;
+    int64_t peak_heap_bytes;
+    int errors;
+} bench_worker_t;
+
+static bench_payload_t response_payload;
+static bench_result_t results[BENCH_MAX_RESULTS];
+static size_t result_count;
+
+static char *read_file(const char *path, size_t *length)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *data = malloc((size_t)size + 1);
+    if (data && fread(data, 1, (size_t)size, file) != (size_t)size)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    if (data)
+    {
+        data[size] = '\0';
+        *length = (size_t)size + 1;
+    }
+    return data;
+}
+
+/* Telegram-like sendMessage reply padded to size bytes */
+static void payload_build(bench_payload_t *payload, size_t size)
+{
+    static const char head[] = "{\"ok\":true,\"result\":{\"message_id\":42,\"chat\":{\"id\":7},\"text\":\"";
+    static const char tail[] = "\"}}";
+    size_t min_size = sizeof(head) - 1 + sizeof(tail) - 1;
+    if (size < min_size)
+        size = min_size;
+    free(payload->body);
+    payload->body = malloc(size + 1);
+    memcpy(payload->body, head, sizeof(head) - 1);
+    memset(payload->body + sizeof(head) - 1, 'a', size - min_size);
+    memcpy(payload->body + size - (sizeof(tail) - 1), tail, sizeof(tail));
+    payload->length = size;
+}
+
+static esp_err_t uri_echo_handler(httpd_req_t *req)
+{
+    char buffer[1024];
+    int ret;
+    while ((ret = httpd_req_recv(req, buffer, sizeof(buffer))) > 0)
+        ;
+    if (ret < 0)
+        return ESP_FAIL;
+    const bench_payload_t *payload = req->user_ctx;
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, payload->body, (ssize_t)payload->length);
+}
+
+static const httpd_uri_t uri_echo = {
+    .uri = "/echo",
+    .method = HTTP_POST,
+    .handler = uri_echo_handler,
+    .user_ctx = &response_payload};
+
+static void *worker_run(void *arg)
+{
+    bench_worker_t *worker = arg;
+    for (int i = 0; i < worker->requests; i++)
+    {
+        int64_t message_id = 0;
+        char text[BENCH_JSON_TEXT_SIZE];
+        httpx_json_field_t fields[] = {
+            {.path = "result.message_id", .type = HTTPX_JSON_TYPE_INT, .value = &message_id},
+            {.path = "result.text", .type = HTTPX_JSON_TYPE_STRING, .value = text, .value_size = sizeof(text)},
+        };
+
+        bench_heap_thread_begin();
+        int64_t start_us = esp_timer_get_time();
+        esp_err_t err;
+        if (worker->api == BENCH_API_JSON)
+            err = httpx_rest_url_data_json(worker->url, HTTP_METHOD_POST, worker->cert_pem, worker->request->body, worker->request->length, CONTENT_TYPE_JSON, fields, 2);
+        else
+            err = httpx_rest_url_data(worker->url, HTTP_METHOD_POST, worker->cert_pem, worker->request->body, worker->request->length, CONTENT_TYPE_JSON);
+        worker->latencies_us[i] = esp_timer_get_time() - start_us;
+        bench_heap_usage_t usage = bench_heap_thread_end();
+
+        worker->allocs += usage.allocs;
+        if (usage.peak_bytes > worker->peak_heap_bytes)
+            worker->peak_heap_bytes = usage.peak_bytes;
+        if (err != ESP_OK || (worker->api == BENCH_API_JSON && (!fields[0].found || message_id != 42)))
+            worker->errors++;
+    }
+    return NULL;
+}
+
+static int compare_int64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int64_t percentile(const int64_t *sorted, int count, int pct)
+{
+    int index = (count * pct + 99) / 100 - 1;
+    return sorted[index < 0 ? 0 : index];
+}
+
+static bench_result_t *result_add(const char *name, const char *transport, const char *api, size_t body_size, int concurrency)
+{
+    if (result_count == BENCH_MAX_RESULTS)
+    {
+        fprintf(stderr, "Too many benchmark results\n");
+        exit(2);
+    }
+    bench_result_t *result = &results[result_count++];
+    memset(result, 0, sizeof(*result));
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    result->transport = transport;
+    result->api = api;
+    result->body_size = body_size;
+    result->concurrency = concurrency;
+    return result;
+}
+
+static void result_set_latencies(bench_result_t *result, int64_t *latencies_us, int count, int64_t elapsed_us)
+{
+    qsort(latencies_us, (size_t)count, sizeof(*latencies_us), compare_int64);
+    result->requests = count;
+    result->req_per_s = elapsed_us > 0 ? count * 1e6 / (double)elapsed_us : 0;
+    result->p50_us = percentile(latencies_us, count, 50);
+    result->p90_us = percentile(latencies_us, count, 90);
+    result->p99_us = percentile(latencies_us, count, 99);
+    result->max_us = latencies_us[count - 1];
+}
+
+/* Every request opens a new connection, which waits in the listen backlog until the
+ * server frees a socket. More clients than either limit only measure dropped SYNs
+ * and their 1 s retries, not the component. */
+static int bench_max_clients(const httpd_config_t *config)
+{
+    int max = config->max_open_sockets;
+    if (config->backlog_conn > 0 && config->backlog_conn < max)
+        max = config->backlog_conn;
+    return max;
+}
+
+static void bench_client(const char *transport, uint16_t port, const char *cert_pem, bench_api_t api, size_t body_size, int concurrency, int requests)
+{
+    char url[64];
+    snprintf(url, sizeof(url), "%s://127.0.0.1:%u/echo", transport, port);
+    bench_payload_t request = {0};
+    payload_build(&request, body_size);
+    payload_build(&response_payload, body_size);
+
+    bench_worker_t workers[BENCH_MAX_CONCURRENCY] = {0};
+    pthread_t threads[BENCH_MAX_CONCURRENCY];
+    int64_t *latencies_us = calloc((size_t)(concurrency * requests), sizeof(*latencies_us));
+    int64_t start_us = esp_timer_get_time();
+    for (int i = 0; i < concurrency; i++)
+    {
+        workers[i] = (bench_worker_t){
+            .url = url,
+            .cert_pem = cert_pem,
+            .api = api,
+            .request = &request,
+            .requests = requests,
+            .latencies_us = latencies_us + i * requests};
+        pthread_create(&threads[i], NULL, worker_run, &workers[i]);
+    }
+    bench_result_t *result = result_add("request", transport, api == BENCH_API_JSON ? "json" : "buffered", body_size, concurrency);
+    uint64_t allocs = 0;
+    for (int i = 0; i < concurrency; i++)
+    {
+        pthread_join(threads[i], NULL);
+        allocs += workers[i].allocs;
+        result->errors += workers[i].errors;
+        if (workers[i].peak_heap_bytes > result->peak_heap_bytes)
+            result->peak_heap_bytes = workers[i].peak_heap_bytes;
+    }
+    result_set_latencies(result, latencies_us, concurrency * requests, esp_timer_get_time() - start_us);
+    result->allocs_per_req = (double)allocs / result->requests;
+    free(latencies_us);
+    free(request.body);
+}
+
+static void bench_server(const char *transport, const char *cert, size_t cert_len, const char *key, size_t key_len, int cycles)
+{
+    int64_t *start_us = calloc((size_t)cycles, sizeof(*start_us));
+    int64_t *stop_us = calloc((size_t)cycles, sizeof(*stop_us));
+    bench_result_t *start = result_add("server_start", transport, "-", 0, 1);
+    bench_result_t *stop = result_add("server_stop", transport, "-", 0, 1);
+    uint64_t start_allocs = 0;
+    uint64_t stop_allocs = 0;
+    for (int i = 0; i < cycles; i++)
+    {
+        httpd_handle_t server = NULL;
+        bench_heap_process_begin();
+        int64_t t0 = esp_timer_get_time();
+        esp_err_t err = cert ? https_server_start(&server, (const uint8_t *)cert, cert_len, (const uint8_t *)key, key_len) : http_server_start(&server);
+        start_us[i] = esp_timer_get_time() - t0;
+        bench_heap_usage_t usage = bench_heap_process_end();
+        start_allocs += usage.allocs;
+        if (usage.peak_bytes > start->peak_heap_bytes)
+            start->peak_heap_bytes = usage.peak_bytes;
+        if (err != ESP_OK)
+        {
+            start->errors++;
+            continue;
+        }
+
+        bench_heap_process_begin();
+        t0 = esp_timer_get_time();
+        err = cert ? https_server_stop(server) : http_server_stop(server);
+        stop_us[i] = esp_timer_get_time() - t0;
+        usage = bench_heap_process_end();
+        stop_allocs += usage.allocs;
+        if (usage.peak_bytes > stop->peak_heap_bytes)
+            stop->peak_heap_bytes = usage.peak_bytes;
+        if (err != ESP_OK)
+            stop->errors++;
+    }
+    result_set_latencies(start, start_us, cycles, 0);
+    result_set_latencies(stop, stop_us, cycles, 0);
+    start->allocs_per_req = (double)start_allocs / cycles;
+    stop->allocs_per_req = (double)stop_allocs / cycles;
+    free(start_us);
+    free(stop_us);
+}
+
+static void results_print(FILE *out, bool csv)
+{
+    if (csv)
+        fprintf(out, "name,transport,api,body_size,concurrency,requests,errors,req_per_s,p50_us,p90_us,p99_us,max_us,allocs_per_req,peak_heap_bytes\n");
+    else
+        fprintf(out, "%-13s %-5s %-8s %7s %4s %6s %4s %9s %8s %8s %8s %8s %9s %10s\n",
+                "name", "proto", "api", "body", "conc", "reqs", "err", "req/s", "p50_us", "p90_us", "p99_us", "max_us", "alloc/req", "peak_heap");
+    for (size_t i = 0; i < result_count; i++)
+    {
+        const bench_result_t *r = &results[i];
+        fprintf(out, csv ? "%s,%s,%s,%zu,%d,%d,%d,%.1f,%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRId64 ",%.1f,%" PRId64 "\n"
+                         : "%-13s %-5s %-8s %7zu %4d %6d %4d %9.1f %8" PRId64 " %8" PRId64 " %8" PRId64 " %8" PRId64 " %9.1f %10" PRId64 "\n",
+                r->name, r->transport, r->api, r->body_size, r->concurrency, r->requests, r->errors, r->req_per_s,
+                r->p50_us, r->p90_us, r->p99_us, r->max_us, r->allocs_per_req, r->peak_heap_bytes);
+    }
+}
+
+static int baseline_compare(const char *path, double tolerance_pct)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        fprintf(stderr, "Cannot open baseline %s\n", path);
+        return 1;
+    }
+    int regressions = 0;
+    char line[512];
+    if (!fgets(line, sizeof(line), file))
+        line[0] = '\0';
+    while (fgets(line, sizeof(line), file))
+    {
+        char name[32], transport[8], api[16];
+        size_t body_size;
+        int concurrency;
+        double allocs_per_req;
+        int64_t peak_heap_bytes;
+        if (sscanf(line, "%31[^,],%7[^,],%15[^,],%zu,%d,%*d,%*d,%*f,%*d,%*d,%*d,%*d,%lf,%" SCNd64,
+                   name, transport, api, &body_size, &concurrency, &allocs_per_req, &peak_heap_bytes) != 7)
+            continue;
+        for (size_t i = 0; i < result_count; i++)
+        {
+            const bench_result_t *r = &results[i];
+            if (strcmp(r->name, name) || strcmp(r->transport, transport) || strcmp(r->api, api) || r->body_size != body_size || r->concurrency != concurrency)
+                continue;
+            double limit = 1.0 + tolerance_pct / 100.0;
+            if (r->allocs_per_req > allocs_per_req * limit + 0.5 || r->peak_heap_bytes > peak_heap_bytes * limit + 64)
+            {
+                fprintf(stderr, "REGRESSION %s %s %s body=%zu conc=%d: alloc/req %.1f -> %.1f, peak heap %" PRId64 " -> %" PRId64 "\n",
+                        name, transport, api, body_size, concurrency, allocs_per_req, r->allocs_per_req, peak_heap_bytes, r->peak_heap_bytes);
+                regressions++;
+            }
+        }
+    }
+    fclose(file);
+    return regressions ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    bool quick = false;
+    int requests = 0;
+    const char *csv_path = NULL;
+    const char *baseline_path = NULL;
+    double tolerance_pct = 10.0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+            quick = true;
+        else if (strcmp(argv[i], "--requests") == 0 && i + 1 < argc)
+            requests = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+            csv_path = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+            baseline_path = argv[++i];
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc)
+            tolerance_pct = atof(argv[++i]);
+        else
+        {
+            fprintf(stderr, "Usage: %s [--quick] [--requests N] [--csv FILE] [--baseline FILE] [--tolerance PERCENT]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (requests <= 0)
+        requests = quick ? 4 : 50;
+
+    size_t cert_len = 0;
+    size_t key_len = 0;
+    char *cert = read_file(BENCH_CERTS_DIR "/servercert.pem", &cert_len);
+    char *key = read_file(BENCH_CERTS_DIR "/prvtkey.pem", &key_len);
+    if (!cert || !key)
+    {
+        fprintf(stderr, "Cannot read certificates from %s\n", BENCH_CERTS_DIR);
+        return 2;
+    }
+
+    static const size_t full_sizes[] = {256, 4096, 65536};
+    static const size_t quick_sizes[] = {256, 4096};
+    static const int full_concurrency[] = {1, 2, 4, 8};
+    static const int quick_concurrency[] = {1, 2};
+    const size_t *sizes = quick ? quick_sizes : full_sizes;
+    size_t size_count = quick ? 2 : 3;
+    const int *concurrency = quick ? quick_concurrency : full_concurrency;
+    size_t concurrency_count = quick ? 2 : 4;
+    /* The servers start with the default configurations */
+    const httpd_config_t http_config = HTTPD_DEFAULT_CONFIG();
+    const httpd_ssl_config_t https_config = HTTPD_SSL_CONFIG_DEFAULT();
+    const int max_clients[] = {bench_max_clients(&http_config), bench_max_clients(&https_config.httpd)};
+
+    httpd_handle_t http_server = NULL;
+    httpd_handle_t https_server = NULL;
+    ESP_ERROR_CHECK(http_server_start(&http_server));
+    ESP_ERROR_CHECK(https_server_start(&https_server, (const uint8_t *)cert, cert_len, (const uint8_t *)key, key_len));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(http_server, &uri_echo));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(https_server, &uri_echo));
+
+    for (int t = 0; t < 2; t++)
+    {
+        const char *transport = t ? "https" : "http";
+        uint16_t port = httpd_host_get_port(t ? https_server : http_server);
+        for (int api = BENCH_API_BUFFERED; api <= BENCH_API_JSON; api++)
+        {
+            for (size_t s = 0; s < size_count; s++)
+            {
+                for (size_t c = 0; c < concurrency_count; c++)
+                {
+                    int clients = concurrency[c] < max_clients[t] ? concurrency[c] : max_clients[t];
+                    bench_client(transport, port, t ? cert : NULL, (bench_api_t)api, sizes[s], clients, requests);
+                    if (clients == max_clients[t])
+                        break;
+                }
+            }
+        }
+    }
+    ESP_ERROR_CHECK(http_server_stop(http_server));
+    ESP_ERROR_CHECK(https_server_stop(https_server));
+
+    int cycles = quick ? 4 : 50;
+    bench_server("http", NULL, 0, NULL, 0, cycles);
+    bench_server("https", cert, cert_len, key, key_len, cycles);
+
+    results_print(stdout, false);
+    int status = 0;
+    for (size_t i = 0; i < result_count; i++)
+    {
+        if (results[i].errors)
+        {
+            ESP_LOGE(BENCH_TAG, "%s %s %s body=%zu conc=%d: %d failed", results[i].name, results[i].transport, results[i].api, results[i].body_size, results[i].concurrency, results[i].errors);
+            status = 1;
+        }
+    }
+    if (csv_path)
+    {
+        FILE *csv = fopen(csv_path, "w");
+        if (!csv)
+        {
+            fprintf(stderr, "Cannot write %s\n", csv_path);
+            return 2;
+        }
+        results_print(csv, true);
+        fclose(csv);
+    }
+    if (baseline_path && baseline_compare(baseline_path, tolerance_pct) != 0)
+        status = 1;
+
+    free(response_payload.body);
+    free(cert);
+    free(key);
+    return status;
+}
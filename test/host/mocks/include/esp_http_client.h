@@ -0,0 +1,79 @@
+#pragma once
+
+#include <esp_err.h>
+
+typedef struct esp_http_client *esp_http_client_handle_t;
+
+typedef enum
+{
+    HTTP_METHOD_GET,
+    HTTP_METHOD_POST,
+    HTTP_METHOD_PUT,
+    HTTP_METHOD_PATCH,
+    HTTP_METHOD_DELETE,
+    HTTP_METHOD_HEAD,
+    HTTP_METHOD_MAX
+} esp_http_client_method_t;
+
+typedef enum
+{
+    HTTP_TRANSPORT_UNKNOWN,
+    HTTP_TRANSPORT_OVER_TCP,
+    HTTP_TRANSPORT_OVER_SSL
+} esp_http_client_transport_t;
+
+typedef enum
+{
+    HTTP_EVENT_ERROR,
+    HTTP_EVENT_ON_CONNECTED,
+    HTTP_EVENT_HEADERS_SENT,
+    HTTP_EVENT_HEADER_SENT = HTTP_EVENT_HEADERS_SENT,
+    HTTP_EVENT_ON_HEADER,
+    HTTP_EVENT_ON_DATA,
+    HTTP_EVENT_ON_FINISH,
+    HTTP_EVENT_DISCONNECTED,
+    HTTP_EVENT_REDIRECT
+} esp_http_client_event_id_t;
+
+typedef struct
+{
+    esp_http_client_event_id_t event_id;
+    esp_http_client_handle_t client;
+    void *data;
+    int data_len;
+    void *user_data;
+    char *header_key;
+    char *header_value;
+} esp_http_client_event_t;
+
+typedef esp_http_client_event_t *esp_http_client_event_handle_t;
+typedef esp_err_t (*http_event_handle_cb)(esp_http_client_event_t *evt);
+
+typedef struct
+{
+    const char *url;
+    const char *cert_pem;
+    size_t cert_len;
+    esp_http_client_method_t method;
+    int timeout_ms;
+    bool disable_auto_redirect;
+    http_event_handle_cb event_handler;
+    esp_http_client_transport_t transport_type;
+    int buffer_size;
+    void *user_data;
+    bool skip_cert_common_name_check;
+} esp_http_client_config_t;
+
+/* Host implementation over POSIX sockets (and OpenSSL for HTTPS). Events are
+ * dispatched in the same order as the IDF client; like the IDF client, the
+ * value returned by the event handler for HTTP_EVENT_ON_DATA does not stop
+ * the transfer. The server certificate is verified against cert_pem, but the
+ * host name is not checked. */
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config);
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client);
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client);
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len);
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value);
+esp_err_t esp_http_client_set_redirection(esp_http_client_handle_t client);
+int esp_http_client_get_status_code(esp_http_client_handle_t client);
+int64_t esp_http_client_get_content_length(esp_http_client_handle_t client);
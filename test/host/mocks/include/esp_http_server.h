@@ -0,0 +1,82 @@
+#pragma once
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <esp_err.h>
+
+typedef void *httpd_handle_t;
+typedef esp_err_t (*httpd_open_func_t)(httpd_handle_t hd, int sockfd);
+typedef void (*httpd_close_func_t)(httpd_handle_t hd, int sockfd);
+
+typedef enum
+{
+    HTTP_DELETE,
+    HTTP_GET,
+    HTTP_HEAD,
+    HTTP_POST,
+    HTTP_PUT
+} httpd_method_t;
+
+typedef struct
+{
+    unsigned task_priority;
+    size_t stack_size;
+    uint16_t server_port;
+    uint16_t max_open_sockets;
+    uint16_t max_uri_handlers;
+    uint16_t backlog_conn;
+    uint16_t recv_wait_timeout;
+    uint16_t send_wait_timeout;
+    httpd_open_func_t open_fn;
+    httpd_close_func_t close_fn;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG()      \
+    {                               \
+        .task_priority = 5,         \
+        .stack_size = 4096,         \
+        .server_port = 80,          \
+        .max_open_sockets = 7,      \
+        .max_uri_handlers = 8,      \
+        .backlog_conn = 5,          \
+        .recv_wait_timeout = 5,     \
+        .send_wait_timeout = 5,     \
+        .open_fn = NULL,            \
+        .close_fn = NULL,           \
+    }
+
+#define HTTPD_RESP_USE_STRLEN -1
+#define HTTPD_MAX_URI_LEN 512
+
+typedef struct
+{
+    httpd_handle_t handle;
+    int method;
+    char uri[HTTPD_MAX_URI_LEN + 1];
+    size_t content_len;
+    void *user_ctx;
+    void *aux;
+} httpd_req_t;
+
+typedef struct
+{
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *r);
+    void *user_ctx;
+} httpd_uri_t;
+
+/* Host implementation: the server listens on an ephemeral loopback port instead
+ * of config->server_port, so it runs unprivileged and several instances can run
+ * side by side; use httpd_host_get_port() to find it. Each connection is served
+ * by its own thread and closed after one request. */
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config);
+esp_err_t httpd_stop(httpd_handle_t handle);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler);
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len);
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type);
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len);
+uint16_t httpd_host_get_port(httpd_handle_t handle);
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <esp_http_server.h>
+
+typedef enum
+{
+    HTTPD_SSL_TRANSPORT_SECURE,
+    HTTPD_SSL_TRANSPORT_INSECURE
+} httpd_ssl_transport_mode_t;
+
+typedef struct
+{
+    httpd_config_t httpd;
+    const uint8_t *servercert;
+    size_t servercert_len;
+    const uint8_t *cacert_pem;
+    size_t cacert_len;
+    const uint8_t *prvtkey_pem;
+    size_t prvtkey_len;
+    httpd_ssl_transport_mode_t transport_mode;
+    uint16_t port_secure;
+    uint16_t port_insecure;
+} httpd_ssl_config_t;
+
+#define HTTPD_SSL_CONFIG_DEFAULT()                      \
+    {                                                   \
+        .httpd = HTTPD_DEFAULT_CONFIG(),                \
+        /* TLS sessions are large, the IDF allows 4 */  \
+        .httpd.max_open_sockets = 4,                    \
+        .servercert = NULL,                             \
+        .servercert_len = 0,                            \
+        .cacert_pem = NULL,                             \
+        .cacert_len = 0,                                \
+        .prvtkey_pem = NULL,                            \
+        .prvtkey_len = 0,                               \
+        .transport_mode = HTTPD_SSL_TRANSPORT_SECURE,   \
+        .port_secure = 443,                             \
+        .port_insecure = 80,                            \
+    }
+
+esp_err_t httpd_ssl_start(httpd_handle_t *handle, httpd_ssl_config_t *config);
+esp_err_t httpd_ssl_stop(httpd_handle_t handle);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_event.h>
+
+typedef struct esp_netif_obj esp_netif_t;
+
+typedef struct
+{
+    uint32_t addr;
+} esp_ip4_addr_t;
+
+typedef struct
+{
+    esp_ip4_addr_t ip;
+    esp_ip4_addr_t netmask;
+    esp_ip4_addr_t gw;
+} esp_netif_ip_info_t;
+
+typedef struct
+{
+    esp_netif_t *esp_netif;
+    esp_netif_ip_info_t ip_info;
+    bool ip_changed;
+} ip_event_got_ip_t;
+
+typedef enum
+{
+    IP_EVENT_STA_GOT_IP,
+    IP_EVENT_STA_LOST_IP
+} ip_event_t;
+
+extern esp_event_base_t const IP_EVENT;
+
+esp_err_t esp_netif_init(void);
+esp_netif_t *esp_netif_create_default_wifi_sta(void);
+void esp_netif_destroy(esp_netif_t *esp_netif);
+char *esp_ip4addr_ntoa(const esp_ip4_addr_t *addr, char *buf, int buflen);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_event.h>
+#include <esp_netif.h>
+
+typedef enum
+{
+    WIFI_AUTH_OPEN,
+    WIFI_AUTH_WEP,
+    WIFI_AUTH_WPA_PSK,
+    WIFI_AUTH_WPA2_PSK,
+    WIFI_AUTH_WPA_WPA2_PSK,
+    WIFI_AUTH_WPA2_ENTERPRISE,
+    WIFI_AUTH_WPA3_PSK,
+    WIFI_AUTH_WPA2_WPA3_PSK
+} wifi_auth_mode_t;
+
+typedef enum
+{
+    WIFI_MODE_NULL,
+    WIFI_MODE_STA,
+    WIFI_MODE_AP,
+    WIFI_MODE_APSTA
+} wifi_mode_t;
+
+typedef enum
+{
+    WIFI_IF_STA,
+    WIFI_IF_AP
+} wifi_interface_t;
+
+typedef enum
+{
+    WIFI_EVENT_WIFI_READY,
+    WIFI_EVENT_SCAN_DONE,
+    WIFI_EVENT_STA_START,
+    WIFI_EVENT_STA_STOP,
+    WIFI_EVENT_STA_CONNECTED,
+    WIFI_EVENT_STA_DISCONNECTED,
+    WIFI_EVENT_STA_AUTHMODE_CHANGE,
+    WIFI_EVENT_STA_BEACON_TIMEOUT,
+    WIFI_EVENT_HOME_CHANNEL_CHANGE
+} wifi_event_t;
+
+typedef struct
+{
+    int unused;
+} wifi_init_config_t;
+
+#define WIFI_INIT_CONFIG_DEFAULT() {0}
+
+typedef struct
+{
+    wifi_auth_mode_t authmode;
+} wifi_scan_threshold_t;
+
+typedef struct
+{
+    uint8_t ssid[32];
+    uint8_t password[64];
+    wifi_scan_threshold_t threshold;
+} wifi_sta_config_t;
+
+typedef union
+{
+    wifi_sta_config_t sta;
+} wifi_config_t;
+
+extern esp_event_base_t const WIFI_EVENT;
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config);
+esp_err_t esp_wifi_deinit(void);
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode);
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *conf);
+esp_err_t esp_wifi_start(void);
+esp_err_t esp_wifi_stop(void);
+esp_err_t esp_wifi_connect(void);
+esp_err_t esp_wifi_disconnect(void);
+esp_err_t esp_wifi_set_default_wifi_sta_handlers(void);
+esp_err_t esp_wifi_clear_default_wifi_driver_and_handlers(void *esp_netif);
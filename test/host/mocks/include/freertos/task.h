@@ -0,0 +1,13 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+
+typedef struct freertos_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+/* Tasks are POSIX threads; priority and stack depth are ignored */
+BaseType_t xTaskCreate(TaskFunction_t task_code, const char *name, uint32_t stack_depth, void *parameters, UBaseType_t priority, TaskHandle_t *created_task);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear_count_on_exit, TickType_t ticks_to_wait);
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <nvs.h>
+
+/* Test hooks of the in-memory NVS partition in mock_nvs.c */
+
+/* Empties the partition and clears injected errors, counters and the log. The
+ * partition holds total_entries 32 byte entries, one page (126) of them reserved. */
+void mock_nvs_reset(size_t total_entries);
+/* Makes every write of key fail with err until called again with err == ESP_OK */
+void mock_nvs_inject_set_error(const char *key, esp_err_t err);
+/* Makes every nvs_commit fail with err until called again with err == ESP_OK */
+void mock_nvs_inject_commit_error(esp_err_t err);
+/* Successful nvs_set_* calls since the last reset */
+uint32_t mock_nvs_write_count(void);
+/* nvs_get_* calls since the last reset */
+uint32_t mock_nvs_read_count(void);
+/* Successful nvs_commit calls since the last reset */
+uint32_t mock_nvs_commit_count(void);
+/* Handles opened and not closed yet */
+uint32_t mock_nvs_open_handle_count(void);
+/* Successful writes and erases since the last reset, e.g. "set:a erase:b set:b " */
+const char *mock_nvs_log(void);
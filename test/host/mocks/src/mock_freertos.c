@@ -0,0 +1,273 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <freertos/event_groups.h>
+
+struct freertos_task
+{
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify_count;
+    TaskFunction_t task_code;
+    void *parameters;
+};
+
+struct freertos_semaphore
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool taken;
+};
+
+struct freertos_event_group
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    EventBits_t bits;
+};
+
+static __thread struct freertos_task *current_task;
+
+static void deadline_after(TickType_t ticks, struct timespec *deadline)
+{
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec += ticks / 1000;
+    deadline->tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L)
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+static void unlock_mutex(void *lock)
+{
+    pthread_mutex_unlock(lock);
+}
+
+/* Waits on cond, returns false on timeout; a cancelled waiter releases lock */
+static bool cond_wait_ticks(pthread_cond_t *cond, pthread_mutex_t *lock, TickType_t ticks, const struct timespec *deadline)
+{
+    int rc;
+    pthread_cleanup_push(unlock_mutex, lock);
+    if (ticks == portMAX_DELAY)
+        rc = pthread_cond_wait(cond, lock);
+    else
+        rc = pthread_cond_timedwait(cond, lock, deadline);
+    pthread_cleanup_pop(0);
+    return rc != ETIMEDOUT;
+}
+
+static struct freertos_task *task_new(void)
+{
+    struct freertos_task *task = calloc(1, sizeof(*task));
+    if (task)
+    {
+        pthread_mutex_init(&task->lock, NULL);
+        pthread_cond_init(&task->cond, NULL);
+    }
+    return task;
+}
+
+static struct freertos_task *task_self(void)
+{
+    if (!current_task)
+    {
+        current_task = task_new();
+        current_task->thread = pthread_self();
+    }
+    return current_task;
+}
+
+static void *task_entry(void *arg)
+{
+    struct freertos_task *task = arg;
+    current_task = task;
+    task->task_code(task->parameters);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task_code, const char *name, uint32_t stack_depth, void *parameters, UBaseType_t priority, TaskHandle_t *created_task)
+{
+    (void)name;
+    (void)stack_depth;
+    (void)priority;
+    struct freertos_task *task = task_new();
+    if (!task)
+        return pdFAIL;
+    task->task_code = task_code;
+    task->parameters = parameters;
+    if (created_task)
+        *created_task = task;
+    if (pthread_create(&task->thread, NULL, task_entry, task) != 0)
+    {
+        free(task);
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+/* Like FreeRTOS, the handle is invalid once the task is deleted. Blocking calls
+ * are cancellation points, so a task blocked on a notification or semaphore can
+ * be deleted from another task. */
+void vTaskDelete(TaskHandle_t task)
+{
+    if (!task || task == current_task)
+    {
+        pthread_detach(pthread_self());
+        pthread_exit(NULL);
+    }
+    pthread_cancel(task->thread);
+    pthread_join(task->thread, NULL);
+    pthread_cond_destroy(&task->cond);
+    pthread_mutex_destroy(&task->lock);
+    free(task);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec delay = {.tv_sec = ticks / 1000, .tv_nsec = (long)(ticks % 1000) * 1000000L};
+    nanosleep(&delay, NULL);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->lock);
+    task->notify_count++;
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_count_on_exit, TickType_t ticks_to_wait)
+{
+    struct freertos_task *task = task_self();
+    struct timespec deadline;
+    deadline_after(ticks_to_wait, &deadline);
+    pthread_mutex_lock(&task->lock);
+    while (task->notify_count == 0 && ticks_to_wait > 0)
+    {
+        if (!cond_wait_ticks(&task->cond, &task->lock, ticks_to_wait, &deadline))
+            break;
+    }
+    uint32_t count = task->notify_count;
+    if (count)
+        task->notify_count = clear_count_on_exit ? 0 : count - 1;
+    pthread_mutex_unlock(&task->lock);
+    return count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    struct freertos_semaphore *semaphore = calloc(1, sizeof(*semaphore));
+    if (semaphore)
+    {
+        pthread_mutex_init(&semaphore->lock, NULL);
+        pthread_cond_init(&semaphore->cond, NULL);
+    }
+    return semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait)
+{
+    struct timespec deadline;
+    deadline_after(ticks_to_wait, &deadline);
+    pthread_mutex_lock(&semaphore->lock);
+    while (semaphore->taken)
+    {
+        if (ticks_to_wait == 0 || !cond_wait_ticks(&semaphore->cond, &semaphore->lock, ticks_to_wait, &deadline))
+        {
+            pthread_mutex_unlock(&semaphore->lock);
+            return pdFALSE;
+        }
+    }
+    semaphore->taken = true;
+    pthread_mutex_unlock(&semaphore->lock);
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    pthread_mutex_lock(&semaphore->lock);
+    semaphore->taken = false;
+    pthread_cond_signal(&semaphore->cond);
+    pthread_mutex_unlock(&semaphore->lock);
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore)
+{
+    pthread_mutex_destroy(&semaphore->lock);
+    pthread_cond_destroy(&semaphore->cond);
+    free(semaphore);
+}
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    struct freertos_event_group *event_group = calloc(1, sizeof(*event_group));
+    if (event_group)
+    {
+        pthread_mutex_init(&event_group->lock, NULL);
+        pthread_cond_init(&event_group->cond, NULL);
+    }
+    return event_group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t event_group, EventBits_t bits)
+{
+    pthread_mutex_lock(&event_group->lock);
+    event_group->bits |= bits;
+    EventBits_t result = event_group->bits;
+    pthread_cond_broadcast(&event_group->cond);
+    pthread_mutex_unlock(&event_group->lock);
+    return result;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t event_group, EventBits_t bits)
+{
+    pthread_mutex_lock(&event_group->lock);
+    EventBits_t result = event_group->bits;
+    event_group->bits &= ~bits;
+    pthread_mutex_unlock(&event_group->lock);
+    return result;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t event_group)
+{
+    pthread_mutex_lock(&event_group->lock);
+    EventBits_t result = event_group->bits;
+    pthread_mutex_unlock(&event_group->lock);
+    return result;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t event_group, EventBits_t bits, BaseType_t clear_on_exit, BaseType_t wait_for_all, TickType_t ticks_to_wait)
+{
+    struct timespec deadline;
+    deadline_after(ticks_to_wait, &deadline);
+    pthread_mutex_lock(&event_group->lock);
+    for (;;)
+    {
+        EventBits_t set = event_group->bits & bits;
+        if ((wait_for_all && set == bits) || (!wait_for_all && set) || ticks_to_wait == 0)
+            break;
+        if (!cond_wait_ticks(&event_group->cond, &event_group->lock, ticks_to_wait, &deadline))
+            break;
+    }
+    EventBits_t result = event_group->bits;
+    if (clear_on_exit)
+        event_group->bits &= ~bits;
+    pthread_mutex_unlock(&event_group->lock);
+    return result;
+}
+
+void vEventGroupDelete(EventGroupHandle_t event_group)
+{
+    pthread_mutex_destroy(&event_group->lock);
+    pthread_cond_destroy(&event_group->cond);
+    free(event_group);
+}
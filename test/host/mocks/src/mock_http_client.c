@@ -0,0 +1,411 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <openssl/err.h>
+#include <openssl/x509.h>
+#include <openssl/pem.h>
+#include <esp_http_client.h>
+#include "mock_tls.h"
+
+#define CLIENT_MAX_HEADERS 16
+#define CLIENT_DEFAULT_BUFFER_SIZE 512
+#define CLIENT_HEADER_MAX_SIZE 4096
+
+typedef struct
+{
+    char *key;
+    char *value;
+} client_header_t;
+
+struct esp_http_client
+{
+    esp_http_client_config_t config;
+    char host[256];
+    char port[8];
+    char *path;
+    bool use_ssl;
+    const char *post_data;
+    int post_len;
+    client_header_t headers[CLIENT_MAX_HEADERS];
+    int header_count;
+    mock_conn_t conn;
+    SSL_CTX *ssl_ctx;
+    bool connected;
+    int status_code;
+    int64_t content_length;
+    char *buffer;
+};
+
+static esp_err_t dispatch(esp_http_client_handle_t client, esp_http_client_event_id_t event_id, void *data, int data_len, char *header_key, char *header_value)
+{
+    if (!client->config.event_handler)
+        return ESP_OK;
+    esp_http_client_event_t event = {
+        .event_id = event_id,
+        .client = client,
+        .data = data,
+        .data_len = data_len,
+        .user_data = client->config.user_data,
+        .header_key = header_key,
+        .header_value = header_value};
+    return client->config.event_handler(&event);
+}
+
+static bool parse_url(esp_http_client_handle_t client, const char *url)
+{
+    const char *host = strstr(url, "://");
+    if (!host)
+        return false;
+    client->use_ssl = strncasecmp(url, "https", 5) == 0;
+    host += 3;
+    const char *path = strchr(host, '/');
+    size_t authority_length = path ? (size_t)(path - host) : strlen(host);
+    const char *port = memchr(host, ':', authority_length);
+    size_t host_length = port ? (size_t)(port - host) : authority_length;
+    if (host_length == 0 || host_length >= sizeof(client->host))
+        return false;
+    memcpy(client->host, host, host_length);
+    client->host[host_length] = '\0';
+    if (port)
+        snprintf(client->port, sizeof(client->port), "%.*s", (int)(authority_length - host_length - 1), port + 1);
+    else
+        strcpy(client->port, client->use_ssl ? "443" : "80");
+    client->path = strdup(path ? path : "/");
+    return client->path != NULL;
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    esp_http_client_handle_t client = calloc(1, sizeof(*client));
+    if (!client)
+        return NULL;
+    client->config = *config;
+    client->conn.fd = -1;
+    if (client->config.buffer_size <= 0)
+        client->config.buffer_size = CLIENT_DEFAULT_BUFFER_SIZE;
+    client->buffer = malloc(client->config.buffer_size);
+    if (!client->buffer || !config->url || !parse_url(client, config->url))
+    {
+        esp_http_client_cleanup(client);
+        return NULL;
+    }
+    if (config->transport_type == HTTP_TRANSPORT_OVER_SSL)
+        client->use_ssl = true;
+    mock_ignore_sigpipe();
+    return client;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len)
+{
+    client->post_data = data;
+    client->post_len = len;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value)
+{
+    for (int i = 0; i < client->header_count; i++)
+    {
+        if (strcasecmp(client->headers[i].key, key) == 0)
+        {
+            char *copy = strdup(value);
+            if (!copy)
+                return ESP_ERR_NO_MEM;
+            free(client->headers[i].value);
+            client->headers[i].value = copy;
+            return ESP_OK;
+        }
+    }
+    if (client->header_count == CLIENT_MAX_HEADERS)
+        return ESP_ERR_NO_MEM;
+    client_header_t *header = &client->headers[client->header_count];
+    header->key = strdup(key);
+    header->value = strdup(value);
+    if (!header->key || !header->value)
+    {
+        free(header->key);
+        free(header->value);
+        return ESP_ERR_NO_MEM;
+    }
+    client->header_count++;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_redirection(esp_http_client_handle_t client)
+{
+    (void)client;
+    return ESP_OK;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+    return client->status_code;
+}
+
+int64_t esp_http_client_get_content_length(esp_http_client_handle_t client)
+{
+    return client->content_length;
+}
+
+static int tcp_connect(esp_http_client_handle_t client)
+{
+    struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+    struct addrinfo *result;
+    if (getaddrinfo(client->host, client->port, &hints, &result) != 0)
+        return -1;
+    int fd = -1;
+    for (struct addrinfo *ai = result; ai && fd < 0; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        struct timeval timeout = {.tv_sec = client->config.timeout_ms / 1000, .tv_usec = (client->config.timeout_ms % 1000) * 1000};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(result);
+    return fd;
+}
+
+static esp_err_t tls_connect(esp_http_client_handle_t client)
+{
+    if (!client->config.cert_pem)
+        return ESP_ERR_INVALID_ARG;
+    client->ssl_ctx = SSL_CTX_new(TLS_client_method());
+    if (!client->ssl_ctx)
+        return ESP_ERR_NO_MEM;
+    X509_STORE *store = SSL_CTX_get_cert_store(client->ssl_ctx);
+    BIO *bio = BIO_new_mem_buf(client->config.cert_pem, client->config.cert_len ? (int)client->config.cert_len : -1);
+    X509 *cert;
+    int cert_count = 0;
+    while (bio && (cert = PEM_read_bio_X509(bio, NULL, NULL, NULL)) != NULL)
+    {
+        X509_STORE_add_cert(store, cert);
+        X509_free(cert);
+        cert_count++;
+    }
+    BIO_free(bio);
+    ERR_clear_error();
+    if (cert_count == 0)
+        return ESP_ERR_INVALID_ARG;
+    X509_VERIFY_PARAM_set_flags(SSL_CTX_get0_param(client->ssl_ctx), X509_V_FLAG_PARTIAL_CHAIN);
+    SSL_CTX_set_verify(client->ssl_ctx, SSL_VERIFY_PEER, NULL);
+    client->conn.ssl = SSL_new(client->ssl_ctx);
+    if (!client->conn.ssl)
+        return ESP_ERR_NO_MEM;
+    SSL_set_fd(client->conn.ssl, client->conn.fd);
+    if (SSL_connect(client->conn.ssl) != 1)
+    {
+        ERR_clear_error();
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static void client_close(esp_http_client_handle_t client)
+{
+    if (client->conn.ssl)
+    {
+        SSL_shutdown(client->conn.ssl);
+        SSL_free(client->conn.ssl);
+        client->conn.ssl = NULL;
+    }
+    if (client->ssl_ctx)
+    {
+        SSL_CTX_free(client->ssl_ctx);
+        client->ssl_ctx = NULL;
+    }
+    if (client->conn.fd >= 0)
+    {
+        close(client->conn.fd);
+        client->conn.fd = -1;
+    }
+    if (client->connected)
+    {
+        client->connected = false;
+        dispatch(client, HTTP_EVENT_DISCONNECTED, NULL, 0, NULL, NULL);
+    }
+}
+
+static esp_err_t send_request(esp_http_client_handle_t client)
+{
+    static const char *const methods[] = {"GET", "POST", "PUT", "PATCH", "DELETE", "HEAD"};
+    const char *method = client->config.method < HTTP_METHOD_MAX ? methods[client->config.method] : "GET";
+    size_t size = 256 + strlen(client->path) + strlen(client->host);
+    for (int i = 0; i < client->header_count; i++)
+        size += strlen(client->headers[i].key) + strlen(client->headers[i].value) + 4;
+    char *request = malloc(size);
+    if (!request)
+        return ESP_ERR_NO_MEM;
+    int length = snprintf(request, size, "%s %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: ESP32 HTTP Client/1.0\r\n", method, client->path, client->host);
+    if (client->post_len > 0 || client->config.method == HTTP_METHOD_POST || client->config.method == HTTP_METHOD_PUT)
+        length += snprintf(request + length, size - length, "Content-Length: %d\r\n", client->post_len);
+    for (int i = 0; i < client->header_count; i++)
+        length += snprintf(request + length, size - length, "%s: %s\r\n", client->headers[i].key, client->headers[i].value);
+    length += snprintf(request + length, size - length, "\r\n");
+    int ret = mock_conn_write_all(&client->conn, request, (size_t)length);
+    free(request);
+    if (ret == 0 && client->post_len > 0)
+        ret = mock_conn_write_all(&client->conn, client->post_data, (size_t)client->post_len);
+    return ret == 0 ? ESP_OK : ESP_FAIL;
+}
+
+/* Reads the status line and headers, body bytes read along with them are dispatched right away */
+static esp_err_t read_headers(esp_http_client_handle_t client, int64_t *received, bool *keep_alive)
+{
+    char *header = malloc(CLIENT_HEADER_MAX_SIZE);
+    if (!header)
+        return ESP_ERR_NO_MEM;
+    int length = 0;
+    char *end = NULL;
+    while (!end)
+    {
+        if (length == CLIENT_HEADER_MAX_SIZE - 1)
+        {
+            free(header);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        int ret = mock_conn_read(&client->conn, header + length, CLIENT_HEADER_MAX_SIZE - 1 - length);
+        if (ret <= 0)
+        {
+            free(header);
+            return ESP_FAIL;
+        }
+        length += ret;
+        header[length] = '\0';
+        end = strstr(header, "\r\n\r\n");
+    }
+    int leftover = length - (int)(end + 4 - header);
+    *end = '\0';
+
+    int minor_version = 1;
+    if (sscanf(header, "HTTP/1.%d %d", &minor_version, &client->status_code) != 2)
+    {
+        free(header);
+        return ESP_FAIL;
+    }
+    *keep_alive = minor_version >= 1;
+    client->content_length = -1;
+    char *line = strstr(header, "\r\n");
+    while (line)
+    {
+        line += 2;
+        char *next = strstr(line, "\r\n");
+        if (next)
+            *next = '\0';
+        char *colon = strchr(line, ':');
+        if (colon)
+        {
+            *colon = '\0';
+            char *value = colon + 1;
+            while (*value == ' ')
+                value++;
+            if (strcasecmp(line, "Content-Length") == 0)
+                client->content_length = strtoll(value, NULL, 10);
+            else if (strcasecmp(line, "Connection") == 0)
+                *keep_alive = strcasecmp(value, "close") != 0;
+            else if (strcasecmp(line, "Transfer-Encoding") == 0 && strcasecmp(value, "chunked") == 0)
+            {
+                free(header);
+                return ESP_ERR_NOT_SUPPORTED;
+            }
+            dispatch(client, HTTP_EVENT_ON_HEADER, NULL, 0, line, value);
+        }
+        line = next;
+    }
+    if (leftover > 0)
+        dispatch(client, HTTP_EVENT_ON_DATA, end + 4, leftover, NULL, NULL);
+    *received = leftover;
+    free(header);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client)
+{
+    if (!client->connected)
+    {
+        client->conn.fd = tcp_connect(client);
+        esp_err_t err = client->conn.fd < 0 ? ESP_FAIL : ESP_OK;
+        if (err == ESP_OK && client->use_ssl)
+            err = tls_connect(client);
+        if (err != ESP_OK)
+        {
+            dispatch(client, HTTP_EVENT_ERROR, NULL, 0, NULL, NULL);
+            client_close(client);
+            return err;
+        }
+        client->connected = true;
+        dispatch(client, HTTP_EVENT_ON_CONNECTED, NULL, 0, NULL, NULL);
+    }
+
+    esp_err_t err = send_request(client);
+    if (err != ESP_OK)
+    {
+        dispatch(client, HTTP_EVENT_ERROR, NULL, 0, NULL, NULL);
+        client_close(client);
+        return err;
+    }
+    dispatch(client, HTTP_EVENT_HEADER_SENT, NULL, 0, NULL, NULL);
+
+    int64_t received = 0;
+    bool keep_alive = true;
+    err = read_headers(client, &received, &keep_alive);
+    if (err != ESP_OK)
+    {
+        dispatch(client, HTTP_EVENT_ERROR, NULL, 0, NULL, NULL);
+        client_close(client);
+        return err;
+    }
+    while (client->content_length < 0 || received < client->content_length)
+    {
+        int64_t remaining = client->content_length >= 0 ? client->content_length - received : client->config.buffer_size;
+        int length = mock_conn_read(&client->conn, client->buffer, remaining < client->config.buffer_size ? (size_t)remaining : (size_t)client->config.buffer_size);
+        if (length == 0 && client->content_length < 0)
+            break;
+        if (length <= 0)
+        {
+            dispatch(client, HTTP_EVENT_ERROR, NULL, 0, NULL, NULL);
+            client_close(client);
+            return ESP_FAIL;
+        }
+        dispatch(client, HTTP_EVENT_ON_DATA, client->buffer, length, NULL, NULL);
+        received += length;
+    }
+    if (client->status_code >= 301 && client->status_code <= 308 && client->config.disable_auto_redirect)
+        dispatch(client, HTTP_EVENT_REDIRECT, NULL, 0, NULL, NULL);
+    dispatch(client, HTTP_EVENT_ON_FINISH, NULL, 0, NULL, NULL);
+    if (!keep_alive)
+        client_close(client);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+    if (!client)
+        return ESP_FAIL;
+    client_close(client);
+    for (int i = 0; i < client->header_count; i++)
+    {
+        free(client->headers[i].key);
+        free(client->headers[i].value);
+    }
+    free(client->path);
+    free(client->buffer);
+    free(client);
+    return ESP_OK;
+}
@@ -0,0 +1,423 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netinet/tcp.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <esp_http_server.h>
+#include <esp_https_server.h>
+#include "mock_tls.h"
+
+#define SERVER_REQUEST_HEADER_MAX_SIZE 4096
+#define SERVER_MAX_URI_HANDLERS 16
+
+typedef struct httpd_server httpd_server_t;
+
+typedef struct
+{
+    httpd_server_t *server;
+    mock_conn_t conn;
+    pthread_t thread;
+    char header[SERVER_REQUEST_HEADER_MAX_SIZE];
+    size_t buffered;
+    size_t buffered_offset;
+    size_t remaining_body;
+    const char *content_type;
+    bool response_sent;
+} httpd_conn_t;
+
+struct httpd_server
+{
+    httpd_config_t config;
+    int listen_fd;
+    uint16_t port;
+    SSL_CTX *ssl_ctx;
+    pthread_t accept_thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool stopping;
+    int active;
+    httpd_conn_t **conns;
+    httpd_uri_t uri_handlers[SERVER_MAX_URI_HANDLERS];
+    size_t uri_handler_count;
+};
+
+static const char *const method_names[] = {"DELETE", "GET", "HEAD", "POST", "PUT"};
+
+static int parse_method(const char *method)
+{
+    for (size_t i = 0; i < sizeof(method_names) / sizeof(method_names[0]); i++)
+    {
+        if (strcmp(method, method_names[i]) == 0)
+            return (int)i;
+    }
+    return -1;
+}
+
+static const httpd_uri_t *find_handler(httpd_server_t *server, const char *uri, int method)
+{
+    size_t uri_length = strcspn(uri, "?");
+    for (size_t i = 0; i < server->uri_handler_count; i++)
+    {
+        const httpd_uri_t *handler = &server->uri_handlers[i];
+        if ((int)handler->method == method && strlen(handler->uri) == uri_length && strncmp(handler->uri, uri, uri_length) == 0)
+            return handler;
+    }
+    return NULL;
+}
+
+static int send_status(httpd_conn_t *c, const char *status)
+{
+    char response[128];
+    int length = snprintf(response, sizeof(response), "HTTP/1.1 %s\r\nContent-Length: 0\r\n\r\n", status);
+    c->response_sent = true;
+    return mock_conn_write_all(&c->conn, response, (size_t)length);
+}
+
+/* Reads one request head; the body that follows is served by httpd_req_recv */
+static bool read_request(httpd_conn_t *c, httpd_req_t *req)
+{
+    if (c->buffered_offset > 0)
+    {
+        memmove(c->header, c->header + c->buffered_offset, c->buffered - c->buffered_offset);
+        c->buffered -= c->buffered_offset;
+        c->buffered_offset = 0;
+    }
+    char *end;
+    for (;;)
+    {
+        c->header[c->buffered] = '\0';
+        if ((end = strstr(c->header, "\r\n\r\n")) != NULL)
+            break;
+        if (c->buffered == sizeof(c->header) - 1)
+            return false;
+        int ret = mock_conn_read(&c->conn, c->header + c->buffered, sizeof(c->header) - 1 - c->buffered);
+        if (ret <= 0)
+            return false;
+        c->buffered += (size_t)ret;
+    }
+    c->buffered_offset = (size_t)(end + 4 - c->header);
+    *end = '\0';
+
+    char method[8];
+    memset(req, 0, sizeof(*req));
+    if (sscanf(c->header, "%7s %512s", method, req->uri) != 2)
+        return false;
+    req->method = parse_method(method);
+    for (char *line = strstr(c->header, "\r\n"); line; line = strstr(line, "\r\n"))
+    {
+        line += 2;
+        if (strncasecmp(line, "Content-Length:", 15) == 0)
+            req->content_len = strtoull(line + 15, NULL, 10);
+    }
+    c->remaining_body = req->content_len;
+    c->content_type = "text/html";
+    c->response_sent = false;
+    req->handle = c->server;
+    req->aux = c;
+    return true;
+}
+
+static void *conn_thread(void *arg)
+{
+    httpd_conn_t *c = arg;
+    httpd_server_t *server = c->server;
+    bool open = true;
+    if (server->ssl_ctx)
+    {
+        c->conn.ssl = SSL_new(server->ssl_ctx);
+        if (!c->conn.ssl || (SSL_set_fd(c->conn.ssl, c->conn.fd), SSL_accept(c->conn.ssl) != 1))
+        {
+            ERR_clear_error();
+            open = false;
+        }
+    }
+    if (open && server->config.open_fn && server->config.open_fn(server, c->conn.fd) != ESP_OK)
+        open = false;
+
+    httpd_req_t req;
+    while (open && read_request(c, &req))
+    {
+        const httpd_uri_t *handler = req.method >= 0 ? find_handler(server, req.uri, req.method) : NULL;
+        if (!handler)
+        {
+            if (send_status(c, "404 Not Found") != 0)
+                break;
+        }
+        else
+        {
+            req.user_ctx = handler->user_ctx;
+            if (handler->handler(&req) != ESP_OK)
+            {
+                if (!c->response_sent)
+                    send_status(c, "500 Internal Server Error");
+                break;
+            }
+        }
+        char drain[256];
+        while (c->remaining_body > 0 && httpd_req_recv(&req, drain, sizeof(drain)) > 0)
+            ;
+    }
+
+    pthread_mutex_lock(&server->lock);
+    for (int i = 0; i < server->config.max_open_sockets; i++)
+    {
+        if (server->conns[i] == c)
+            server->conns[i] = NULL;
+    }
+    pthread_mutex_unlock(&server->lock);
+
+    /* Same order as the IDF server: the user close_fn owns closing the socket */
+    if (c->conn.ssl)
+        SSL_shutdown(c->conn.ssl);
+    if (server->config.close_fn)
+        server->config.close_fn(server, c->conn.fd);
+    else
+        close(c->conn.fd);
+    if (c->conn.ssl)
+        SSL_free(c->conn.ssl);
+    ERR_clear_error();
+
+    pthread_mutex_lock(&server->lock);
+    server->active--;
+    pthread_cond_broadcast(&server->cond);
+    pthread_mutex_unlock(&server->lock);
+    free(c);
+    return NULL;
+}
+
+static void *accept_thread(void *arg)
+{
+    httpd_server_t *server = arg;
+    for (;;)
+    {
+        pthread_mutex_lock(&server->lock);
+        while (!server->stopping && server->active >= server->config.max_open_sockets)
+            pthread_cond_wait(&server->cond, &server->lock);
+        bool stopping = server->stopping;
+        pthread_mutex_unlock(&server->lock);
+        if (stopping)
+            break;
+
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0)
+        {
+            pthread_mutex_lock(&server->lock);
+            stopping = server->stopping;
+            pthread_mutex_unlock(&server->lock);
+            if (stopping)
+                break;
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        httpd_conn_t *c = calloc(1, sizeof(*c));
+        if (!c)
+        {
+            close(fd);
+            continue;
+        }
+        c->server = server;
+        c->conn.fd = fd;
+        pthread_mutex_lock(&server->lock);
+        for (int i = 0; i < server->config.max_open_sockets; i++)
+        {
+            if (!server->conns[i])
+            {
+                server->conns[i] = c;
+                break;
+            }
+        }
+        server->active++;
+        pthread_mutex_unlock(&server->lock);
+        if (pthread_create(&c->thread, NULL, conn_thread, c) != 0)
+        {
+            pthread_mutex_lock(&server->lock);
+            for (int i = 0; i < server->config.max_open_sockets; i++)
+            {
+                if (server->conns[i] == c)
+                    server->conns[i] = NULL;
+            }
+            server->active--;
+            pthread_mutex_unlock(&server->lock);
+            close(fd);
+            free(c);
+            continue;
+        }
+        pthread_detach(c->thread);
+    }
+    return NULL;
+}
+
+static esp_err_t server_start(httpd_handle_t *handle, const httpd_config_t *config, SSL_CTX *ssl_ctx)
+{
+    httpd_server_t *server = calloc(1, sizeof(*server));
+    if (!server)
+        return ESP_ERR_NO_MEM;
+    server->config = *config;
+    if (server->config.max_open_sockets == 0)
+        server->config.max_open_sockets = 1;
+    server->ssl_ctx = ssl_ctx;
+    server->conns = calloc(server->config.max_open_sockets, sizeof(*server->conns));
+    pthread_mutex_init(&server->lock, NULL);
+    pthread_cond_init(&server->cond, NULL);
+    mock_ignore_sigpipe();
+
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK), .sin_port = 0};
+    socklen_t addr_len = sizeof(addr);
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (!server->conns || server->listen_fd < 0 ||
+        bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(server->listen_fd, server->config.backlog_conn ? server->config.backlog_conn : 5) != 0 ||
+        getsockname(server->listen_fd, (struct sockaddr *)&addr, &addr_len) != 0 ||
+        pthread_create(&server->accept_thread, NULL, accept_thread, server) != 0)
+    {
+        if (server->listen_fd >= 0)
+            close(server->listen_fd);
+        free(server->conns);
+        free(server);
+        return ESP_FAIL;
+    }
+    server->port = ntohs(addr.sin_port);
+    *handle = server;
+    return ESP_OK;
+}
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    return server_start(handle, config, NULL);
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    httpd_server_t *server = handle;
+    if (!server)
+        return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&server->lock);
+    server->stopping = true;
+    pthread_cond_broadcast(&server->cond);
+    pthread_mutex_unlock(&server->lock);
+    shutdown(server->listen_fd, SHUT_RDWR);
+    pthread_join(server->accept_thread, NULL);
+    close(server->listen_fd);
+
+    pthread_mutex_lock(&server->lock);
+    for (int i = 0; i < server->config.max_open_sockets; i++)
+    {
+        if (server->conns[i])
+            shutdown(server->conns[i]->conn.fd, SHUT_RDWR);
+    }
+    while (server->active > 0)
+        pthread_cond_wait(&server->cond, &server->lock);
+    pthread_mutex_unlock(&server->lock);
+
+    if (server->ssl_ctx)
+        SSL_CTX_free(server->ssl_ctx);
+    pthread_mutex_destroy(&server->lock);
+    pthread_cond_destroy(&server->cond);
+    free(server->conns);
+    free(server);
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    httpd_server_t *server = handle;
+    pthread_mutex_lock(&server->lock);
+    esp_err_t err = ESP_OK;
+    if (server->uri_handler_count == SERVER_MAX_URI_HANDLERS || server->uri_handler_count == server->config.max_uri_handlers)
+        err = ESP_ERR_NO_MEM;
+    else
+        server->uri_handlers[server->uri_handler_count++] = *uri_handler;
+    pthread_mutex_unlock(&server->lock);
+    return err;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    httpd_conn_t *c = r->aux;
+    if (c->remaining_body == 0)
+        return 0;
+    if (buf_len > c->remaining_body)
+        buf_len = c->remaining_body;
+    int ret;
+    if (c->buffered_offset < c->buffered)
+    {
+        ret = (int)(c->buffered - c->buffered_offset < buf_len ? c->buffered - c->buffered_offset : buf_len);
+        memcpy(buf, c->header + c->buffered_offset, (size_t)ret);
+        c->buffered_offset += (size_t)ret;
+    }
+    else if ((ret = mock_conn_read(&c->conn, buf, buf_len)) <= 0)
+        return -1;
+    c->remaining_body -= (size_t)ret;
+    return ret;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+    httpd_conn_t *c = r->aux;
+    c->content_type = type;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    httpd_conn_t *c = r->aux;
+    if (buf_len == HTTPD_RESP_USE_STRLEN)
+        buf_len = buf ? (ssize_t)strlen(buf) : 0;
+    char head[256];
+    int length = snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %zd\r\n\r\n", c->content_type, buf_len);
+    c->response_sent = true;
+    if (mock_conn_write_all(&c->conn, head, (size_t)length) != 0 || (buf_len > 0 && mock_conn_write_all(&c->conn, buf, (size_t)buf_len) != 0))
+        return ESP_FAIL;
+    return ESP_OK;
+}
+
+uint16_t httpd_host_get_port(httpd_handle_t handle)
+{
+    return ((httpd_server_t *)handle)->port;
+}
+
+/* PEM buffers from EMBED_TXTFILES include the terminating NUL in their length */
+static BIO *pem_bio(const uint8_t *pem, size_t len)
+{
+    return BIO_new_mem_buf(pem, (int)strnlen((const char *)pem, len));
+}
+
+esp_err_t httpd_ssl_start(httpd_handle_t *handle, httpd_ssl_config_t *config)
+{
+    if (!config->servercert || !config->prvtkey_pem)
+        return ESP_ERR_INVALID_ARG;
+    SSL_CTX *ssl_ctx = SSL_CTX_new(TLS_server_method());
+    if (!ssl_ctx)
+        return ESP_ERR_NO_MEM;
+    BIO *cert_bio = pem_bio(config->servercert, config->servercert_len);
+    BIO *key_bio = pem_bio(config->prvtkey_pem, config->prvtkey_len);
+    X509 *cert = cert_bio ? PEM_read_bio_X509(cert_bio, NULL, NULL, NULL) : NULL;
+    EVP_PKEY *key = key_bio ? PEM_read_bio_PrivateKey(key_bio, NULL, NULL, NULL) : NULL;
+    bool loaded = cert && key && SSL_CTX_use_certificate(ssl_ctx, cert) == 1 && SSL_CTX_use_PrivateKey(ssl_ctx, key) == 1;
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    BIO_free(cert_bio);
+    BIO_free(key_bio);
+    ERR_clear_error();
+    if (!loaded)
+    {
+        SSL_CTX_free(ssl_ctx);
+        return ESP_FAIL;
+    }
+    httpd_config_t httpd_config = config->httpd;
+    httpd_config.server_port = config->port_secure;
+    esp_err_t err = server_start(handle, &httpd_config, ssl_ctx);
+    if (err != ESP_OK)
+        SSL_CTX_free(ssl_ctx);
+    return err;
+}
+
+esp_err_t httpd_ssl_stop(httpd_handle_t handle)
+{
+    return httpd_stop(handle);
+}
@@ -0,0 +1,435 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <nvs_flash.h>
+#include <mock_nvs.h>
+
+/*
+ * The host build has no flash: the partition is a small in-memory table. Space is
+ * accounted in 32 byte entries like the IDF implementation, including the page it
+ * keeps free for garbage collection and the new copy of a key being written
+ * before the old one is erased. Erased entries are reclaimed at once.
+ */
+
+#define MOCK_NVS_MAX_ITEMS 64
+#define MOCK_NVS_MAX_HANDLES 16
+#define MOCK_NVS_MAX_VALUE_SIZE 4000
+#define MOCK_NVS_PAGE_ENTRIES 126
+#define MOCK_NVS_ENTRY_SIZE 32
+
+typedef struct
+{
+    bool used;
+    char namespace_name[NVS_NS_NAME_MAX_SIZE];
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    nvs_type_t type;
+    size_t length;
+    uint8_t value[MOCK_NVS_MAX_VALUE_SIZE];
+} mock_nvs_item_t;
+
+struct nvs_opaque_iterator_t
+{
+    char namespace_name[NVS_NS_NAME_MAX_SIZE];
+    nvs_type_t type;
+    size_t index;
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static mock_nvs_item_t items[MOCK_NVS_MAX_ITEMS];
+static char handles[MOCK_NVS_MAX_HANDLES][NVS_NS_NAME_MAX_SIZE];
+static bool handle_open[MOCK_NVS_MAX_HANDLES];
+static size_t total_entries = 6 * MOCK_NVS_PAGE_ENTRIES;
+static char set_error_key[NVS_KEY_NAME_MAX_SIZE];
+static esp_err_t set_error;
+static esp_err_t commit_error;
+static uint32_t write_count;
+static uint32_t read_count;
+static uint32_t commit_count;
+static char op_log[1024];
+
+static size_t item_span(nvs_type_t type, size_t length)
+{
+    if (type == NVS_TYPE_STR)
+        return 1 + (length + MOCK_NVS_ENTRY_SIZE - 1) / MOCK_NVS_ENTRY_SIZE;
+    if (type == NVS_TYPE_BLOB)
+        return 2 + (length + MOCK_NVS_ENTRY_SIZE - 1) / MOCK_NVS_ENTRY_SIZE;
+    return 1;
+}
+
+static size_t used_entries(void)
+{
+    size_t used = 0;
+    for (size_t i = 0; i < MOCK_NVS_MAX_ITEMS; i++)
+    {
+        if (items[i].used)
+            used += item_span(items[i].type, items[i].length);
+    }
+    return used;
+}
+
+static size_t available_entries(void)
+{
+    size_t used = used_entries() + MOCK_NVS_PAGE_ENTRIES;
+    return total_entries > used ? total_entries - used : 0;
+}
+
+static const char *handle_namespace(nvs_handle_t handle)
+{
+    if (handle == 0 || handle > MOCK_NVS_MAX_HANDLES || !handle_open[handle - 1])
+        return NULL;
+    return handles[handle - 1];
+}
+
+static mock_nvs_item_t *find_item(const char *namespace_name, const char *key)
+{
+    for (size_t i = 0; i < MOCK_NVS_MAX_ITEMS; i++)
+    {
+        if (items[i].used && strcmp(items[i].namespace_name, namespace_name) == 0 && strcmp(items[i].key, key) == 0)
+            return &items[i];
+    }
+    return NULL;
+}
+
+static void log_op(const char *op, const char *key)
+{
+    size_t length = strlen(op_log);
+    snprintf(op_log + length, sizeof(op_log) - length, "%s:%s ", op, key);
+}
+
+static esp_err_t set_item(nvs_handle_t handle, const char *key, nvs_type_t type, const void *value, size_t length)
+{
+    if (strlen(key) >= NVS_KEY_NAME_MAX_SIZE)
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    if (length > MOCK_NVS_MAX_VALUE_SIZE)
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    pthread_mutex_lock(&lock);
+    const char *namespace_name = handle_namespace(handle);
+    esp_err_t err = ESP_OK;
+    if (!namespace_name)
+        err = ESP_ERR_NVS_INVALID_HANDLE;
+    else if (set_error != ESP_OK && strcmp(set_error_key, key) == 0)
+        err = set_error;
+    mock_nvs_item_t *item = err == ESP_OK ? find_item(namespace_name, key) : NULL;
+    /* The new copy is written while the old one still takes up its entries */
+    if (err == ESP_OK && item_span(type, length) > available_entries())
+        err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    if (err == ESP_OK && !item)
+    {
+        for (size_t i = 0; i < MOCK_NVS_MAX_ITEMS && !item; i++)
+        {
+            if (!items[i].used)
+                item = &items[i];
+        }
+        if (!item)
+            err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    if (err == ESP_OK)
+    {
+        item->used = true;
+        strcpy(item->namespace_name, namespace_name);
+        strcpy(item->key, key);
+        item->type = type;
+        item->length = length;
+        memcpy(item->value, value, length);
+        write_count++;
+        log_op("set", key);
+    }
+    pthread_mutex_unlock(&lock);
+    return err;
+}
+
+static esp_err_t get_item(nvs_handle_t handle, const char *key, nvs_type_t type, void *out_value, size_t *length)
+{
+    pthread_mutex_lock(&lock);
+    read_count++;
+    const char *namespace_name = handle_namespace(handle);
+    esp_err_t err = ESP_OK;
+    mock_nvs_item_t *item = namespace_name ? find_item(namespace_name, key) : NULL;
+    if (!namespace_name)
+        err = ESP_ERR_NVS_INVALID_HANDLE;
+    /* The IDF looks keys up by type, so a key of another type is not found */
+    else if (!item || item->type != type)
+        err = ESP_ERR_NVS_NOT_FOUND;
+    else if (!length)
+        memcpy(out_value, item->value, item->length);
+    else if (!out_value)
+        *length = item->length;
+    else if (*length < item->length)
+        err = ESP_ERR_NVS_INVALID_LENGTH;
+    else
+    {
+        memcpy(out_value, item->value, item->length);
+        *length = item->length;
+    }
+    pthread_mutex_unlock(&lock);
+    return err;
+}
+
+void mock_nvs_reset(size_t entries)
+{
+    pthread_mutex_lock(&lock);
+    memset(items, 0, sizeof(items));
+    total_entries = entries;
+    set_error = ESP_OK;
+    commit_error = ESP_OK;
+    write_count = 0;
+    read_count = 0;
+    commit_count = 0;
+    op_log[0] = '\0';
+    pthread_mutex_unlock(&lock);
+}
+
+void mock_nvs_inject_set_error(const char *key, esp_err_t err)
+{
+    pthread_mutex_lock(&lock);
+    strncpy(set_error_key, key, sizeof(set_error_key) - 1);
+    set_error = err;
+    pthread_mutex_unlock(&lock);
+}
+
+void mock_nvs_inject_commit_error(esp_err_t err)
+{
+    pthread_mutex_lock(&lock);
+    commit_error = err;
+    pthread_mutex_unlock(&lock);
+}
+
+uint32_t mock_nvs_write_count(void)
+{
+    pthread_mutex_lock(&lock);
+    uint32_t count = write_count;
+    pthread_mutex_unlock(&lock);
+    return count;
+}
+
+uint32_t mock_nvs_read_count(void)
+{
+    pthread_mutex_lock(&lock);
+    uint32_t count = read_count;
+    pthread_mutex_unlock(&lock);
+    return count;
+}
+
+uint32_t mock_nvs_commit_count(void)
+{
+    pthread_mutex_lock(&lock);
+    uint32_t count = commit_count;
+    pthread_mutex_unlock(&lock);
+    return count;
+}
+
+uint32_t mock_nvs_open_handle_count(void)
+{
+    pthread_mutex_lock(&lock);
+    uint32_t count = 0;
+    for (size_t i = 0; i < MOCK_NVS_MAX_HANDLES; i++)
+        count += handle_open[i];
+    pthread_mutex_unlock(&lock);
+    return count;
+}
+
+const char *mock_nvs_log(void)
+{
+    return op_log;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    pthread_mutex_lock(&lock);
+    memset(items, 0, sizeof(items));
+    pthread_mutex_unlock(&lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    (void)open_mode;
+    if (strlen(namespace_name) >= NVS_NS_NAME_MAX_SIZE)
+        return ESP_ERR_NVS_INVALID_NAME;
+    pthread_mutex_lock(&lock);
+    esp_err_t err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    for (size_t i = 0; i < MOCK_NVS_MAX_HANDLES; i++)
+    {
+        if (!handle_open[i])
+        {
+            handle_open[i] = true;
+            strcpy(handles[i], namespace_name);
+            *out_handle = i + 1;
+            err = ESP_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return err;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    pthread_mutex_lock(&lock);
+    if (handle_namespace(handle))
+        handle_open[handle - 1] = false;
+    pthread_mutex_unlock(&lock);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    pthread_mutex_lock(&lock);
+    esp_err_t err = !handle_namespace(handle) ? ESP_ERR_NVS_INVALID_HANDLE : commit_error;
+    if (err == ESP_OK)
+        commit_count++;
+    pthread_mutex_unlock(&lock);
+    return err;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    pthread_mutex_lock(&lock);
+    const char *namespace_name = handle_namespace(handle);
+    mock_nvs_item_t *item = namespace_name ? find_item(namespace_name, key) : NULL;
+    esp_err_t err = !namespace_name ? ESP_ERR_NVS_INVALID_HANDLE : !item ? ESP_ERR_NVS_NOT_FOUND : ESP_OK;
+    if (item)
+    {
+        item->used = false;
+        log_op("erase", key);
+    }
+    pthread_mutex_unlock(&lock);
+    return err;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+    pthread_mutex_lock(&lock);
+    const char *namespace_name = handle_namespace(handle);
+    for (size_t i = 0; namespace_name && i < MOCK_NVS_MAX_ITEMS; i++)
+    {
+        if (items[i].used && strcmp(items[i].namespace_name, namespace_name) == 0)
+            items[i].used = false;
+    }
+    if (namespace_name)
+        log_op("erase_all", namespace_name);
+    pthread_mutex_unlock(&lock);
+    return namespace_name ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+    return set_item(handle, key, NVS_TYPE_U32, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char *key, int32_t value)
+{
+    return set_item(handle, key, NVS_TYPE_I32, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    return set_item(handle, key, NVS_TYPE_STR, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return set_item(handle, key, NVS_TYPE_BLOB, value, length);
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value)
+{
+    return get_item(handle, key, NVS_TYPE_U32, out_value, NULL);
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char *key, int32_t *out_value)
+{
+    return get_item(handle, key, NVS_TYPE_I32, out_value, NULL);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+    return get_item(handle, key, NVS_TYPE_STR, out_value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    return get_item(handle, key, NVS_TYPE_BLOB, out_value, length);
+}
+
+esp_err_t nvs_get_stats(const char *part_name, nvs_stats_t *nvs_stats)
+{
+    (void)part_name;
+    pthread_mutex_lock(&lock);
+    nvs_stats->used_entries = used_entries();
+    nvs_stats->free_entries = total_entries - nvs_stats->used_entries;
+    nvs_stats->available_entries = available_entries();
+    nvs_stats->total_entries = total_entries;
+    nvs_stats->namespace_count = 0;
+    pthread_mutex_unlock(&lock);
+    return ESP_OK;
+}
+
+/* Moves the iterator to the first matching item at or after its index */
+static esp_err_t iterator_seek(nvs_iterator_t iterator)
+{
+    for (; iterator->index < MOCK_NVS_MAX_ITEMS; iterator->index++)
+    {
+        const mock_nvs_item_t *item = &items[iterator->index];
+        if (item->used && strcmp(item->namespace_name, iterator->namespace_name) == 0 &&
+            (iterator->type == NVS_TYPE_ANY || iterator->type == item->type))
+            return ESP_OK;
+    }
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_entry_find(const char *part_name, const char *namespace_name, nvs_type_t type, nvs_iterator_t *output_iterator)
+{
+    (void)part_name;
+    *output_iterator = NULL;
+    nvs_iterator_t iterator = calloc(1, sizeof(*iterator));
+    if (!iterator)
+        return ESP_ERR_NO_MEM;
+    strncpy(iterator->namespace_name, namespace_name, sizeof(iterator->namespace_name) - 1);
+    iterator->type = type;
+    pthread_mutex_lock(&lock);
+    esp_err_t err = iterator_seek(iterator);
+    pthread_mutex_unlock(&lock);
+    if (err != ESP_OK)
+    {
+        free(iterator);
+        return err;
+    }
+    *output_iterator = iterator;
+    return ESP_OK;
+}
+
+esp_err_t nvs_entry_next(nvs_iterator_t *iterator)
+{
+    (*iterator)->index++;
+    pthread_mutex_lock(&lock);
+    esp_err_t err = iterator_seek(*iterator);
+    pthread_mutex_unlock(&lock);
+    if (err != ESP_OK)
+    {
+        free(*iterator);
+        *iterator = NULL;
+    }
+    return err;
+}
+
+esp_err_t nvs_entry_info(const nvs_iterator_t iterator, nvs_entry_info_t *out_info)
+{
+    pthread_mutex_lock(&lock);
+    const mock_nvs_item_t *item = &items[iterator->index];
+    strcpy(out_info->namespace_name, item->namespace_name);
+    strcpy(out_info->key, item->key);
+    out_info->type = item->type;
+    pthread_mutex_unlock(&lock);
+    return ESP_OK;
+}
+
+void nvs_release_iterator(nvs_iterator_t iterator)
+{
+    free(iterator);
+}
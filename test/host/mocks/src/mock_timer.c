@@ -0,0 +1,139 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <esp_timer.h>
+
+struct esp_timer
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool armed;
+    bool deleted;
+    int64_t deadline_us;
+};
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/* Every timer has its own dispatch thread; the IDF shares one esp_timer task */
+static void *timer_thread(void *arg)
+{
+    struct esp_timer *timer = arg;
+    pthread_mutex_lock(&timer->lock);
+    while (!timer->deleted)
+    {
+        if (!timer->armed)
+        {
+            pthread_cond_wait(&timer->cond, &timer->lock);
+            continue;
+        }
+        int64_t remaining_us = timer->deadline_us - esp_timer_get_time();
+        if (remaining_us > 0)
+        {
+            struct timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_sec += remaining_us / 1000000;
+            deadline.tv_nsec += (remaining_us % 1000000) * 1000;
+            if (deadline.tv_nsec >= 1000000000L)
+            {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&timer->cond, &timer->lock, &deadline);
+            continue;
+        }
+        timer->armed = false;
+        pthread_mutex_unlock(&timer->lock);
+        timer->callback(timer->arg);
+        pthread_mutex_lock(&timer->lock);
+    }
+    pthread_mutex_unlock(&timer->lock);
+    return NULL;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    struct esp_timer *timer = calloc(1, sizeof(*timer));
+    if (!timer)
+        return ESP_ERR_NO_MEM;
+    timer->callback = create_args->callback;
+    timer->arg = create_args->arg;
+    pthread_mutex_init(&timer->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&timer->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (pthread_create(&timer->thread, NULL, timer_thread, timer) != 0)
+    {
+        free(timer);
+        return ESP_ERR_NO_MEM;
+    }
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&timer->lock);
+    if (timer->armed)
+        err = ESP_ERR_INVALID_STATE;
+    else
+    {
+        timer->armed = true;
+        timer->deadline_us = esp_timer_get_time() + (int64_t)timeout_us;
+        pthread_cond_signal(&timer->cond);
+    }
+    pthread_mutex_unlock(&timer->lock);
+    return err;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&timer->lock);
+    if (!timer->armed)
+        err = ESP_ERR_INVALID_STATE;
+    timer->armed = false;
+    pthread_mutex_unlock(&timer->lock);
+    return err;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&timer->lock);
+    if (timer->armed)
+    {
+        pthread_mutex_unlock(&timer->lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->deleted = true;
+    pthread_cond_signal(&timer->cond);
+    pthread_mutex_unlock(&timer->lock);
+    if (pthread_equal(timer->thread, pthread_self()))
+    {
+        pthread_detach(timer->thread);
+        return ESP_OK;
+    }
+    pthread_join(timer->thread, NULL);
+    pthread_mutex_destroy(&timer->lock);
+    pthread_cond_destroy(&timer->cond);
+    free(timer);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&timer->lock);
+    bool armed = timer->armed;
+    pthread_mutex_unlock(&timer->lock);
+    return armed;
+}
@@ -0,0 +1,45 @@
+#include <signal.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include "mock_tls.h"
+
+int mock_conn_read(mock_conn_t *conn, void *buf, size_t len)
+{
+    if (conn->ssl)
+    {
+        int ret = SSL_read(conn->ssl, buf, (int)len);
+        return ret > 0 ? ret : (SSL_get_error(conn->ssl, ret) == SSL_ERROR_ZERO_RETURN ? 0 : -1);
+    }
+    ssize_t ret;
+    do
+        ret = recv(conn->fd, buf, len, 0);
+    while (ret < 0 && errno == EINTR);
+    return (int)ret;
+}
+
+int mock_conn_write_all(mock_conn_t *conn, const void *buf, size_t len)
+{
+    const char *data = buf;
+    while (len > 0)
+    {
+        ssize_t ret;
+        if (conn->ssl)
+            ret = SSL_write(conn->ssl, data, (int)len);
+        else
+            ret = send(conn->fd, data, len, MSG_NOSIGNAL);
+        if (ret <= 0)
+        {
+            if (!conn->ssl && ret < 0 && errno == EINTR)
+                continue;
+            return -1;
+        }
+        data += ret;
+        len -= (size_t)ret;
+    }
+    return 0;
+}
+
+void mock_ignore_sigpipe(void)
+{
+    signal(SIGPIPE, SIG_IGN);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stddef.h>
+#include <openssl/ssl.h>
+
+/* Plain or TLS socket shared by the host HTTP client and server */
+typedef struct
+{
+    int fd;
+    SSL *ssl;
+} mock_conn_t;
+
+int mock_conn_read(mock_conn_t *conn, void *buf, size_t len);
+int mock_conn_write_all(mock_conn_t *conn, const void *buf, size_t len);
+void mock_ignore_sigpipe(void);
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <esp_wifi.h>
+
+/* Wi-Fi, netif and the default event loop are not simulated: the host is
+ * already connected and no events are ever posted */
+
+esp_event_base_t const WIFI_EVENT = "WIFI_EVENT";
+esp_event_base_t const IP_EVENT = "IP_EVENT";
+
+struct esp_netif_obj
+{
+    int unused;
+};
+
+esp_err_t esp_event_loop_create_default(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler, void *event_handler_arg, esp_event_handler_instance_t *instance)
+{
+    (void)event_base;
+    (void)event_id;
+    (void)event_handler;
+    (void)event_handler_arg;
+    *instance = NULL;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_unregister(esp_event_base_t event_base, int32_t event_id, esp_event_handler_instance_t instance)
+{
+    (void)event_base;
+    (void)event_id;
+    (void)instance;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_init(void)
+{
+    return ESP_OK;
+}
+
+esp_netif_t *esp_netif_create_default_wifi_sta(void)
+{
+    return calloc(1, sizeof(esp_netif_t));
+}
+
+void esp_netif_destroy(esp_netif_t *esp_netif)
+{
+    free(esp_netif);
+}
+
+char *esp_ip4addr_ntoa(const esp_ip4_addr_t *addr, char *buf, int buflen)
+{
+    const uint8_t *bytes = (const uint8_t *)&addr->addr;
+    snprintf(buf, buflen, "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+    return buf;
+}
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config)
+{
+    (void)config;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_deinit(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)
+{
+    (void)mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *conf)
+{
+    (void)interface;
+    (void)conf;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_stop(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_connect(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_disconnect(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_default_wifi_sta_handlers(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_clear_default_wifi_driver_and_handlers(void *esp_netif)
+{
+    (void)esp_netif;
+    return ESP_OK;
+}
@@ -0,0 +1,369 @@
+/*
+ * Host tests of the streaming JSON field parser behind httpx_rest_url_data_json.
+ *
+ * Every document is parsed once whole, once one byte at a time and once split at
+ * every possible offset, since the HTTP client hands the body over in chunks of
+ * arbitrary size.
+ */
+#include "WiFi_utils.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures;
+
+#define CHECK(cond)                                                          \
+    do                                                                       \
+    {                                                                        \
+        if (!(cond))                                                         \
+        {                                                                    \
+            printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                      \
+        }                                                                    \
+    } while (0)
+
+/* Holds the value of one field, whatever its type */
+typedef union
+{
+    int64_t integer;
+    double number;
+    bool boolean;
+    char string[64];
+} test_values_t;
+
+/* Feeds doc as two chunks split at split, or a byte at a time when bytewise is set */
+static esp_err_t parse_split(const char *doc, size_t split, bool bytewise, httpx_json_field_t *fields, size_t field_count)
+{
+    httpx_json_parser_t parser;
+    httpx_json_parser_init(&parser, fields, field_count);
+    size_t length = strlen(doc);
+    esp_err_t err = ESP_OK;
+    if (bytewise)
+    {
+        for (size_t i = 0; i < length && err == ESP_OK; i++)
+            err = httpx_json_parser_feed(&parser, doc + i, 1);
+    }
+    else
+    {
+        err = httpx_json_parser_feed(&parser, doc, split);
+        if (err == ESP_OK)
+            err = httpx_json_parser_feed(&parser, doc + split, length - split);
+    }
+    if (err == ESP_OK)
+        err = httpx_json_parser_finish(&parser);
+
+    return err;
+}
+
+/* Parses doc in every chunking and checks they all agree with the whole-document result */
+static esp_err_t parse(const char *doc, httpx_json_field_t *fields, size_t field_count)
+{
+    httpx_json_field_t expected[8];
+    test_values_t expected_values[8];
+    for (size_t i = 0; i < field_count; i++)
+        memset(fields[i].value, 0x5A, sizeof(test_values_t));
+    esp_err_t expected_err = parse_split(doc, strlen(doc), false, fields, field_count);
+    for (size_t i = 0; i < field_count; i++)
+    {
+        expected[i] = fields[i];
+        memcpy(&expected_values[i], fields[i].value, sizeof(test_values_t));
+    }
+
+    size_t length = strlen(doc);
+    for (size_t split = 0; split <= length + 1; split++)
+    {
+        for (size_t i = 0; i < field_count; i++)
+            memset(fields[i].value, 0x5A, sizeof(test_values_t));
+        esp_err_t err = split <= length ? parse_split(doc, split, false, fields, field_count) : parse_split(doc, 0, true, fields, field_count);
+        if (err != expected_err)
+        {
+            printf("split %zu of %s: err 0x%x, expected 0x%x\n", split, doc, err, expected_err);
+            failures++;
+            continue;
+        }
+        for (size_t i = 0; i < field_count; i++)
+        {
+            if (fields[i].found != expected[i].found ||
+                (fields[i].found && memcmp(fields[i].value, &expected_values[i], sizeof(test_values_t)) != 0))
+            {
+                printf("split %zu of %s: field %s differs\n", split, doc, fields[i].path);
+                failures++;
+            }
+        }
+    }
+    for (size_t i = 0; i < field_count; i++)
+    {
+        fields[i].found = expected[i].found;
+        memcpy(fields[i].value, &expected_values[i], sizeof(test_values_t));
+    }
+
+    return expected_err;
+}
+
+static httpx_json_field_t field(const char *path, httpx_json_type_t type, test_values_t *values)
+{
+    httpx_json_field_t f = {.path = path, .type = type, .value = values};
+    if (type == HTTPX_JSON_TYPE_STRING)
+        f.value_size = sizeof(values->string);
+    return f;
+}
+
+static void test_telegram_response(void)
+{
+    const char *doc = "{\"ok\":true,\"result\":{\"message_id\":4711,\"from\":{\"id\":1,\"is_bot\":true},"
+                      "\"chat\":{\"id\":-100123,\"title\":\"x\"},\"date\":1700000000,\"text\":\"Hello\","
+                      "\"entities\":[{\"offset\":0,\"length\":5,\"type\":\"bold\"}]}}";
+    test_values_t v[5];
+    httpx_json_field_t fields[] = {
+        field("ok", HTTPX_JSON_TYPE_BOOL, &v[0]),
+        field("result.message_id", HTTPX_JSON_TYPE_INT, &v[1]),
+        field("result.chat.id", HTTPX_JSON_TYPE_INT, &v[2]),
+        field("result.text", HTTPX_JSON_TYPE_STRING, &v[3]),
+        field("result.entities[0].type", HTTPX_JSON_TYPE_STRING, &v[4]),
+    };
+    CHECK(parse(doc, fields, 5) == ESP_OK);
+    CHECK(fields[0].found && v[0].boolean);
+    CHECK(fields[1].found && v[1].integer == 4711);
+    CHECK(fields[2].found && v[2].integer == -100123);
+    CHECK(fields[3].found && strcmp(v[3].string, "Hello") == 0);
+    CHECK(fields[4].found && strcmp(v[4].string, "bold") == 0);
+}
+
+static void test_paths(void)
+{
+    const char *doc = " [ {\"a\" : [ 1 , [ 2 , 3 ] , { \"b\" : \"x\" } ] } , { \"a.c\" : 9, \"a\" : { \"b\" : 7 } } ] ";
+    test_values_t v[6];
+    httpx_json_field_t fields[] = {
+        field("[0].a[0]", HTTPX_JSON_TYPE_INT, &v[0]),
+        field("[0].a[1][1]", HTTPX_JSON_TYPE_INT, &v[1]),
+        field("[0].a[2].b", HTTPX_JSON_TYPE_STRING, &v[2]),
+        field("[1].a.b", HTTPX_JSON_TYPE_INT, &v[3]),
+        field("[0].a[3]", HTTPX_JSON_TYPE_INT, &v[4]),
+        field("[0].a", HTTPX_JSON_TYPE_INT, &v[5]),
+    };
+    CHECK(parse(doc, fields, 6) == ESP_OK);
+    CHECK(fields[0].found && v[0].integer == 1);
+    CHECK(fields[1].found && v[1].integer == 3);
+    CHECK(fields[2].found && strcmp(v[2].string, "x") == 0);
+    CHECK(fields[3].found && v[3].integer == 7);
+    CHECK(!fields[4].found);
+    CHECK(!fields[5].found);
+
+    /* Array indexes are plain decimal numbers */
+    const char *bad_paths[] = {"[0].a[ 1]", "[0].a[+1]", "[0].a[01]", "[0].a[1 ]", "[0].a[]", "[0].a[-0]", "[0].a[4294967297]", "[0].a[0x1]"};
+    for (size_t i = 0; i < sizeof(bad_paths) / sizeof(bad_paths[0]); i++)
+    {
+        httpx_json_field_t bad = field(bad_paths[i], HTTPX_JSON_TYPE_INT, &v[0]);
+        CHECK(parse(doc, &bad, 1) == ESP_OK);
+        if (bad.found)
+        {
+            printf("path %s matched\n", bad_paths[i]);
+            failures++;
+        }
+    }
+    httpx_json_field_t zero = field("[0].a[0]", HTTPX_JSON_TYPE_INT, &v[0]);
+    CHECK(parse(doc, &zero, 1) == ESP_OK && zero.found && v[0].integer == 1);
+}
+
+static void test_escapes(void)
+{
+    const char *doc = "{\"s\":\"q\\\"b\\\\s\\/n\\nt\\tr\\rb\\bf\\f\",\"k\\u0065y\":\"v\"}";
+    test_values_t v[2];
+    httpx_json_field_t fields[] = {
+        field("s", HTTPX_JSON_TYPE_STRING, &v[0]),
+        field("key", HTTPX_JSON_TYPE_STRING, &v[1]),
+    };
+    CHECK(parse(doc, fields, 2) == ESP_OK);
+    CHECK(fields[0].found && strcmp(v[0].string, "q\"b\\s/n\nt\tr\rb\bf\f") == 0);
+    CHECK(fields[1].found && strcmp(v[1].string, "v") == 0);
+
+    CHECK(parse("{\"s\":\"\\x\"}", fields, 1) == ESP_ERR_INVALID_RESPONSE);
+    CHECK(parse("{\"s\":\"\\u12G4\"}", fields, 1) == ESP_ERR_INVALID_RESPONSE);
+    CHECK(parse("{\"s\":\"a\nb\"}", fields, 1) == ESP_ERR_INVALID_RESPONSE);
+}
+
+static void test_unicode(void)
+{
+    const char *doc = "{\"a\":\"\\u0041\\u00e9\\u20AC\",\"b\":\"\\ud83d\\ude00!\",\"c\":\"\\ude00x\"}";
+    test_values_t v[3];
+    httpx_json_field_t fields[] = {
+        field("a", HTTPX_JSON_TYPE_STRING, &v[0]),
+        field("b", HTTPX_JSON_TYPE_STRING, &v[1]),
+        field("c", HTTPX_JSON_TYPE_STRING, &v[2]),
+    };
+    CHECK(parse(doc, fields, 3) == ESP_OK);
+    CHECK(fields[0].found && strcmp(v[0].string, "A\xC3\xA9\xE2\x82\xAC") == 0);
+    CHECK(fields[1].found && strcmp(v[1].string, "\xF0\x9F\x98\x80!") == 0);
+    /* A lone low surrogate becomes U+FFFD */
+    CHECK(fields[2].found && strcmp(v[2].string, "\xEF\xBF\xBDx") == 0);
+
+    /* So does a high surrogate without a low one, wherever the string goes next.
+     * It never pairs with a surrogate from another string. */
+    const char *lone = "{\"a\":\"\\uD83D\",\"b\":\"\\uDE00\",\"c\":\"\\uD83Dx\\uD83D\\n\",\"k\\uD83D\":\"\\uDE00\","
+                       "\"d\":\"\\uD83D\\uD83D\\uDE00\"}";
+    test_values_t w[4];
+    httpx_json_field_t lone_fields[] = {
+        field("a", HTTPX_JSON_TYPE_STRING, &w[0]),
+        field("b", HTTPX_JSON_TYPE_STRING, &w[1]),
+        field("c", HTTPX_JSON_TYPE_STRING, &w[2]),
+        field("d", HTTPX_JSON_TYPE_STRING, &w[3]),
+    };
+    CHECK(parse(lone, lone_fields, 4) == ESP_OK);
+    CHECK(lone_fields[0].found && strcmp(w[0].string, "\xEF\xBF\xBD") == 0);
+    CHECK(lone_fields[1].found && strcmp(w[1].string, "\xEF\xBF\xBD") == 0);
+    CHECK(lone_fields[2].found && strcmp(w[2].string, "\xEF\xBF\xBDx\xEF\xBF\xBD\n") == 0);
+    CHECK(lone_fields[3].found && strcmp(w[3].string, "\xEF\xBF\xBD\xF0\x9F\x98\x80") == 0);
+}
+
+static void test_string_truncation(void)
+{
+    char small[4];
+    httpx_json_field_t fields[] = {{.path = "s", .type = HTTPX_JSON_TYPE_STRING, .value = small, .value_size = sizeof(small)}};
+    httpx_json_parser_t parser;
+    httpx_json_parser_init(&parser, fields, 1);
+    const char *doc = "{\"s\":\"hello\"}";
+    CHECK(httpx_json_parser_feed(&parser, doc, strlen(doc)) == ESP_OK);
+    CHECK(httpx_json_parser_finish(&parser) == ESP_OK);
+    CHECK(fields[0].found && strcmp(small, "hel") == 0);
+}
+
+static void test_numbers(void)
+{
+    test_values_t v[6];
+    httpx_json_field_t fields[] = {
+        field("i", HTTPX_JSON_TYPE_INT, &v[0]),
+        field("d", HTTPX_JSON_TYPE_DOUBLE, &v[1]),
+        field("big", HTTPX_JSON_TYPE_INT, &v[2]),
+        field("min", HTTPX_JSON_TYPE_INT, &v[3]),
+        field("huge", HTTPX_JSON_TYPE_DOUBLE, &v[4]),
+        field("long", HTTPX_JSON_TYPE_INT, &v[5]),
+    };
+    const char *doc = "{\"i\":-0,\"d\":-1.25E+2,\"big\":9223372036854775808,\"min\":-9223372036854775808,"
+                      "\"huge\":1e400,\"long\":1234567890123456789012345678901234567890}";
+    CHECK(parse(doc, fields, 6) == ESP_OK);
+    CHECK(fields[0].found && v[0].integer == 0);
+    CHECK(fields[1].found && v[1].number == -125.0);
+    CHECK(!fields[2].found);
+    CHECK(fields[3].found && v[3].integer == INT64_MIN);
+    CHECK(!fields[4].found);
+    CHECK(!fields[5].found);
+
+    const char *invalid[] = {"nan", "01", "1.", "-", "1e", "1e+", "-01", "1.e5", ".5", "+1", "0x10", "1.5.2", "tru", "nul",
+                             "12345678901234567890123456789012345.", "infinity"};
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    {
+        char doc_invalid[80];
+        snprintf(doc_invalid, sizeof(doc_invalid), "{\"i\":%s}", invalid[i]);
+        if (parse(doc_invalid, fields, 1) != ESP_ERR_INVALID_RESPONSE)
+        {
+            printf("accepted invalid number %s\n", invalid[i]);
+            failures++;
+        }
+    }
+
+    /* A bare scalar is only complete once the parser is finished */
+    CHECK(parse("42", fields, 0) == ESP_OK);
+    CHECK(parse("[1e5,0.5,-0.0e-0,null,false]", fields, 0) == ESP_OK);
+}
+
+static void test_type_mismatch(void)
+{
+    test_values_t v[4];
+    httpx_json_field_t fields[] = {
+        field("a", HTTPX_JSON_TYPE_INT, &v[0]),
+        field("b", HTTPX_JSON_TYPE_BOOL, &v[1]),
+        field("c", HTTPX_JSON_TYPE_INT, &v[2]),
+        field("d", HTTPX_JSON_TYPE_STRING, &v[3]),
+    };
+    CHECK(parse("{\"a\":\"1\",\"b\":1,\"c\":1.5,\"d\":true}", fields, 4) == ESP_OK);
+    CHECK(!fields[0].found);
+    CHECK(!fields[1].found);
+    CHECK(!fields[2].found);
+    CHECK(fields[3].found && strcmp(v[3].string, "true") == 0);
+}
+
+static void test_depth(void)
+{
+    char doc[1024];
+    test_values_t v[3];
+    httpx_json_field_t fields[] = {
+        field("a.a.a.a.a.a.a.a", HTTPX_JSON_TYPE_INT, &v[0]),
+        field("a.a.a.a.a.a.a.a.a", HTTPX_JSON_TYPE_INT, &v[1]),
+        field("ok", HTTPX_JSON_TYPE_BOOL, &v[2]),
+    };
+
+    /* Nested objects 40 levels deep with a shallow field after them */
+    size_t length = 0;
+    length += sprintf(doc + length, "{");
+    for (int i = 0; i < 40; i++)
+        length += sprintf(doc + length, "\"a\":%s", i < 39 ? "{" : "1");
+    for (int i = 0; i < 39; i++)
+        length += sprintf(doc + length, ",\"b\":[[]]}");
+    sprintf(doc + length, ",\"ok\":true}");
+    CHECK(parse(doc, fields, 3) == ESP_OK);
+    CHECK(!fields[0].found);
+    CHECK(!fields[1].found);
+    CHECK(fields[2].found && v[2].boolean);
+
+    /* The deepest field that can be extracted */
+    CHECK(parse("{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":5}}}}}}}}", fields, 2) == ESP_OK);
+    CHECK(fields[0].found && v[0].integer == 5);
+    CHECK(!fields[1].found);
+
+    /* Mismatched brackets below the extraction depth are still caught */
+    CHECK(parse("[[[[[[[[[[[[{\"x\":1]]]]]]]]]]]]", fields, 0) == ESP_ERR_INVALID_RESPONSE);
+    CHECK(parse("[[[[[[[[[[[[{\"x\":1},2]]]]]]]]]]]]", fields, 0) == ESP_OK);
+    CHECK(parse("[[[[[[[[[[[[{\"x\" 1}]]]]]]]]]]]]", fields, 0) == ESP_ERR_INVALID_RESPONSE);
+
+    memset(doc, '[', HTTPX_JSON_MAX_NESTING);
+    memset(doc + HTTPX_JSON_MAX_NESTING, ']', HTTPX_JSON_MAX_NESTING);
+    doc[2 * HTTPX_JSON_MAX_NESTING] = '\0';
+    CHECK(parse(doc, fields, 0) == ESP_OK);
+    doc[0] = '\0';
+    memset(doc, '[', HTTPX_JSON_MAX_NESTING + 1);
+    doc[HTTPX_JSON_MAX_NESTING + 1] = '\0';
+    CHECK(parse(doc, fields, 0) == ESP_ERR_INVALID_RESPONSE);
+}
+
+static void test_invalid_documents(void)
+{
+    const char *invalid[] = {"", "{", "{\"a\":1", "{\"a\":1,}", "{\"a\" 1}", "{\"a\":1]", "[1,]", "[1 2]", "{}}", "{} x", "{a:1}", "\"abc"};
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    {
+        if (parse(invalid[i], NULL, 0) != ESP_ERR_INVALID_RESPONSE)
+        {
+            printf("accepted invalid document %s\n", invalid[i]);
+            failures++;
+        }
+    }
+
+    /* After an error the parser keeps failing */
+    httpx_json_parser_t parser;
+    httpx_json_parser_init(&parser, NULL, 0);
+    CHECK(httpx_json_parser_feed(&parser, "{]", 2) == ESP_ERR_INVALID_RESPONSE);
+    CHECK(httpx_json_parser_feed(&parser, "}", 1) == ESP_ERR_INVALID_RESPONSE);
+    CHECK(httpx_json_parser_finish(&parser) == ESP_ERR_INVALID_RESPONSE);
+}
+
+int main(void)
+{
+    /* Most documents below are invalid on purpose */
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    test_telegram_response();
+    test_paths();
+    test_escapes();
+    test_unicode();
+    test_string_truncation();
+    test_numbers();
+    test_type_mismatch();
+    test_depth();
+    test_invalid_documents();
+
+    if (failures)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All JSON parser tests passed\n");
+    return 0;
+}
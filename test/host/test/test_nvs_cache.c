@@ -0,0 +1,375 @@
+/*
+ * Host tests of the write-coalescing NVS cache against the in-memory NVS partition
+ * of mocks/src/mock_nvs.c.
+ */
+#include "WiFi_utils.h"
+#include <mock_nvs.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NVS_PAGE_ENTRIES 126
+#define NAMESPACE "test"
+
+static int failures;
+
+#define CHECK(cond)                                                          \
+    do                                                                       \
+    {                                                                        \
+        if (!(cond))                                                         \
+        {                                                                    \
+            printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                      \
+        }                                                                    \
+    } while (0)
+
+/* Waits up to two seconds for the commit task or timer to get cond true */
+#define WAIT_UNTIL(cond)                                            \
+    do                                                              \
+    {                                                               \
+        for (int wait_ms = 0; !(cond) && wait_ms < 2000; wait_ms++) \
+            usleep(1000);                                           \
+        CHECK(cond);                                                \
+    } while (0)
+
+static nvs_cache_stats_t stats(nvs_cache_handle_t *cache)
+{
+    nvs_cache_stats_t cache_stats;
+    nvs_cache_get_stats(cache, &cache_stats);
+    return cache_stats;
+}
+
+static esp_err_t cache_init(nvs_cache_handle_t *cache, uint32_t commit_interval_ms, uint8_t commit_threshold)
+{
+    const nvs_cache_config_t config = {
+        .namespace_name = NAMESPACE,
+        .commit_interval_ms = commit_interval_ms,
+        .commit_threshold = commit_threshold,
+    };
+    return nvs_cache_init(cache, config);
+}
+
+/* Reads a key straight from the mocked flash, bypassing the cache */
+static uint32_t flash_u32(const char *key)
+{
+    nvs_handle_t handle;
+    uint32_t value = 0;
+    nvs_open(NAMESPACE, NVS_READONLY, &handle);
+    if (nvs_get_u32(handle, key, &value) != ESP_OK)
+        value = UINT32_MAX;
+    nvs_close(handle);
+    return value;
+}
+
+static void flash_set_u32(const char *key, uint32_t value)
+{
+    nvs_handle_t handle;
+    nvs_open(NAMESPACE, NVS_READWRITE, &handle);
+    nvs_set_u32(handle, key, value);
+    nvs_close(handle);
+}
+
+static void flash_set_str(const char *key, const char *value)
+{
+    nvs_handle_t handle;
+    nvs_open(NAMESPACE, NVS_READWRITE, &handle);
+    nvs_set_str(handle, key, value);
+    nvs_close(handle);
+}
+
+static void flash_set_blob(const char *key, const void *value, size_t length)
+{
+    nvs_handle_t handle;
+    nvs_open(NAMESPACE, NVS_READWRITE, &handle);
+    nvs_set_blob(handle, key, value, length);
+    nvs_close(handle);
+}
+
+static void test_preload(void)
+{
+    mock_nvs_reset(6 * NVS_PAGE_ENTRIES);
+    flash_set_u32("u", 7);
+    flash_set_str("s", "hi");
+    flash_set_blob("b", "\x01\x02\x03", 3);
+
+    static nvs_cache_handle_t cache;
+    CHECK(cache_init(&cache, 0, 0) == ESP_OK);
+    uint32_t reads = mock_nvs_read_count();
+    uint32_t u = 0;
+    char s[8];
+    size_t length = sizeof(s);
+    uint8_t b[8];
+    CHECK(nvs_cache_get_u32(&cache, "u", &u) == ESP_OK && u == 7);
+    CHECK(nvs_cache_get_str(&cache, "s", s, &length) == ESP_OK && length == 3 && strcmp(s, "hi") == 0);
+    length = 0;
+    CHECK(nvs_cache_get_blob(&cache, "b", NULL, &length) == ESP_OK && length == 3);
+    CHECK(nvs_cache_get_blob(&cache, "b", b, &length) == ESP_OK && memcmp(b, "\x01\x02\x03", 3) == 0);
+    length = 1;
+    CHECK(nvs_cache_get_blob(&cache, "b", b, &length) == ESP_ERR_NVS_INVALID_LENGTH);
+    CHECK(nvs_cache_get_u32(&cache, "missing", &u) == ESP_ERR_NVS_NOT_FOUND);
+    int32_t i;
+    CHECK(nvs_cache_get_i32(&cache, "u", &i) == ESP_ERR_NVS_TYPE_MISMATCH);
+    /* The whole namespace is in RAM, so none of the reads reached flash */
+    CHECK(mock_nvs_read_count() == reads);
+    CHECK(nvs_cache_deinit(&cache) == ESP_OK);
+    CHECK(mock_nvs_open_handle_count() == 0);
+}
+
+static void test_dirty_tracking(void)
+{
+    mock_nvs_reset(6 * NVS_PAGE_ENTRIES);
+    static nvs_cache_handle_t cache;
+    CHECK(cache_init(&cache, 0, 0) == ESP_OK);
+
+    CHECK(nvs_cache_set_u32(&cache, "a", 1) == ESP_OK);
+    CHECK(nvs_cache_set_u32(&cache, "a", 1) == ESP_OK);
+    CHECK(nvs_cache_set_u32(&cache, "b", 2) == ESP_OK);
+    CHECK(nvs_cache_set_u32(&cache, "b", 3) == ESP_OK);
+    CHECK(nvs_cache_set_i32(&cache, "a", 1) == ESP_ERR_NVS_TYPE_MISMATCH);
+    CHECK(mock_nvs_write_count() == 0);
+    nvs_cache_stats_t cache_stats = stats(&cache);
+    CHECK(cache_stats.write_count == 5);
+    CHECK(cache_stats.skipped_write_count == 1);
+
+    CHECK(nvs_cache_commit(&cache) == ESP_OK);
+    CHECK(mock_nvs_write_count() == 2 && mock_nvs_commit_count() == 1);
+    CHECK(flash_u32("a") == 1 && flash_u32("b") == 3);
+    cache_stats = stats(&cache);
+    CHECK(cache_stats.commit_count == 1 && cache_stats.committed_entry_count == 2);
+
+    /* Nothing dirty, nothing written */
+    CHECK(nvs_cache_set_u32(&cache, "a", 1) == ESP_OK);
+    CHECK(nvs_cache_commit(&cache) == ESP_OK);
+    CHECK(mock_nvs_write_count() == 2 && mock_nvs_commit_count() == 1);
+    CHECK(stats(&cache).skipped_write_count == 2);
+    CHECK(nvs_cache_deinit(&cache) == ESP_OK);
+}
+
+static void test_threshold(void)
+{
+    mock_nvs_reset(6 * NVS_PAGE_ENTRIES);
+    static nvs_cache_handle_t cache;
+    CHECK(cache_init(&cache, 0, 2) == ESP_OK);
+
+    CHECK(nvs_cache_set_u32(&cache, "a", 1) == ESP_OK);
+    usleep(20000);
+    CHECK(mock_nvs_write_count() == 0);
+    CHECK(nvs_cache_set_u32(&cache, "b", 2) == ESP_OK);
+    WAIT_UNTIL(stats(&cache).commit_count == 1);
+    CHECK(flash_u32("a") == 1 && flash_u32("b") == 2);
+
+    /* A failed background commit is not reported to the writer, the value stays in RAM */
+    mock_nvs_inject_set_error("c", ESP_FAIL);
+    CHECK(nvs_cache_set_u32(&cache, "c", 3) == ESP_OK);
+    CHECK(nvs_cache_set_u32(&cache, "d", 4) == ESP_OK);
+    WAIT_UNTIL(stats(&cache).failed_commit_count == 1);
+    CHECK(flash_u32("c") == UINT32_MAX && flash_u32("d") == 4);
+    uint32_t c = 0;
+    CHECK(nvs_cache_get_u32(&cache, "c", &c) == ESP_OK && c == 3);
+    mock_nvs_inject_set_error("c", ESP_OK);
+    CHECK(nvs_cache_commit(&cache) == ESP_OK);
+    CHECK(flash_u32("c") == 3);
+    CHECK(nvs_cache_deinit(&cache) == ESP_OK);
+}
+
+static void test_persisted_keys_first(void)
+{
+    mock_nvs_reset(6 * NVS_PAGE_ENTRIES);
+    static nvs_cache_handle_t cache;
+    CHECK(cache_init(&cache, 0, 0) == ESP_OK);
+
+    /* "n" takes the first cache entry but never reaches flash */
+    mock_nvs_inject_set_error("n", ESP_FAIL);
+    CHECK(nvs_cache_set_u32(&cache, "n", 1) == ESP_OK);
+    CHECK(nvs_cache_set_u32(&cache, "p", 1) == ESP_OK);
+    CHECK(nvs_cache_commit(&cache) == ESP_FAIL);
+    CHECK(strcmp(mock_nvs_log(), "set:p ") == 0);
+    CHECK(stats(&cache).failed_commit_count == 1);
+
+    mock_nvs_inject_set_error("n", ESP_OK);
+    CHECK(nvs_cache_set_u32(&cache, "p", 2) == ESP_OK);
+    CHECK(nvs_cache_commit(&cache) == ESP_OK);
+    CHECK(strcmp(mock_nvs_log(), "set:p set:p set:n ") == 0);
+    CHECK(nvs_cache_deinit(&cache) == ESP_OK);
+}
+
+static void test_rewrite_in_place(void)
+{
+    const char *old_value = "0123456789012345678901234567890123456789012345678";
+    const char *new_value = "abcdefghijabcdefghijabcdefghijabcdefghijabcdefghi";
+    /* "s" takes 3 entries and "u" 1, which leaves a single free entry */
+    mock_nvs_reset(NVS_PAGE_ENTRIES + 3 + 1 + 1);
+    flash_set_str("s", old_value);
+    flash_set_u32("u", 1);
+
+    static nvs_cache_handle_t cache;
+    CHECK(cache_init(&cache, 0, 0) == ESP_OK);
+    CHECK(nvs_cache_set_str(&cache, "s", new_value) == ESP_OK);
+    CHECK(nvs_cache_commit(&cache) == ESP_OK);
+    CHECK(strstr(mock_nvs_log(), "erase:s set:s ") != NULL);
+    CHECK(stats(&cache).compaction_count == 1);
+    CHECK(nvs_cache_deinit(&cache) == ESP_OK);
+
+    nvs_handle_t handle;
+    char value[64];
+    size_t length = sizeof(value);
+    nvs_open(NAMESPACE, NVS_READONLY, &handle);
+    CHECK(nvs_get_str(handle, "s", value, &length) == ESP_OK && strcmp(value, new_value) == 0);
+    nvs_close(handle);
+    CHECK(flash_u32("u") == 1);
+}
+
+static void test_rewrite_refused(void)
+{
+    uint8_t old_blob[10] = {1};
+    uint8_t new_blob[64] = {2};
+    /* The old blob takes 3 entries and the new one would need 4, with none free */
+    mock_nvs_reset(NVS_PAGE_ENTRIES + 3);
+    flash_set_blob("b", old_blob, sizeof(old_blob));
+
+    static nvs_cache_handle_t cache;
+    CHECK(cache_init(&cache, 0, 0) == ESP_OK);
+    CHECK(nvs_cache_set_blob(&cache, "b", new_blob, sizeof(new_blob)) == ESP_OK);
+    CHECK(nvs_cache_set_u32(&cache, "n", 1) == ESP_OK);
+    CHECK(nvs_cache_commit(&cache) == ESP_ERR_NVS_NOT_ENOUGH_SPACE);
+    /* Nothing was erased, the old value is still in flash */
+    CHECK(strstr(mock_nvs_log(), "erase") == NULL);
+    nvs_cache_stats_t cache_stats = stats(&cache);
+    CHECK(cache_stats.compaction_count == 0 && cache_stats.failed_commit_count == 1);
+
+    nvs_handle_t handle;
+    uint8_t value[64];
+    size_t length = sizeof(value);
+    nvs_open(NAMESPACE, NVS_READONLY, &handle);
+    CHECK(nvs_get_blob(handle, "b", value, &length) == ESP_OK && length == sizeof(old_blob) && value[0] == 1);
+    nvs_close(handle);
+
+    /* Both entries are still dirty and are written once there is room */
+    mock_nvs_reset(6 * NVS_PAGE_ENTRIES);
+    CHECK(nvs_cache_commit(&cache) == ESP_OK);
+    CHECK(flash_u32("n") == 1);
+    CHECK(nvs_cache_deinit(&cache) == ESP_OK);
+}
+
+static void test_timer_retries(void)
+{
+    mock_nvs_reset(6 * NVS_PAGE_ENTRIES);
+    static nvs_cache_handle_t cache;
+    CHECK(cache_init(&cache, 20, 0) == ESP_OK);
+
+    CHECK(nvs_cache_set_u32(&cache, "a", 1) == ESP_OK);
+    CHECK(mock_nvs_write_count() == 0);
+    WAIT_UNTIL(stats(&cache).commit_count == 1);
+    CHECK(flash_u32("a") == 1);
+
+    /* A failed timed commit is retried until it succeeds */
+    mock_nvs_inject_commit_error(ESP_FAIL);
+    CHECK(nvs_cache_set_u32(&cache, "a", 2) == ESP_OK);
+    WAIT_UNTIL(stats(&cache).failed_commit_count >= 2);
+    mock_nvs_inject_commit_error(ESP_OK);
+    WAIT_UNTIL(stats(&cache).commit_count == 2);
+
+    /* So is a failed explicit commit */
+    mock_nvs_inject_set_error("b", ESP_FAIL);
+    CHECK(nvs_cache_set_u32(&cache, "b", 1) == ESP_OK);
+    CHECK(nvs_cache_commit(&cache) == ESP_FAIL);
+    mock_nvs_inject_set_error("b", ESP_OK);
+    WAIT_UNTIL(stats(&cache).commit_count == 3);
+    CHECK(flash_u32("b") == 1);
+    CHECK(nvs_cache_deinit(&cache) == ESP_OK);
+}
+
+static void test_deinit(void)
+{
+    mock_nvs_reset(6 * NVS_PAGE_ENTRIES);
+    static nvs_cache_handle_t cache;
+    CHECK(cache_init(&cache, 10000, 8) == ESP_OK);
+    CHECK(nvs_cache_set_u32(&cache, "a", 5) == ESP_OK);
+    CHECK(nvs_cache_deinit(&cache) == ESP_OK);
+    CHECK(flash_u32("a") == 5);
+    CHECK(mock_nvs_open_handle_count() == 0);
+
+    /* A failed final commit is reported, everything is released regardless */
+    CHECK(cache_init(&cache, 10000, 8) == ESP_OK);
+    mock_nvs_inject_set_error("a", ESP_FAIL);
+    CHECK(nvs_cache_set_u32(&cache, "a", 6) == ESP_OK);
+    CHECK(nvs_cache_deinit(&cache) == ESP_FAIL);
+    CHECK(mock_nvs_open_handle_count() == 0);
+    CHECK(cache.mutex == NULL && cache.commit_timer == NULL && cache.commit_task == NULL);
+    mock_nvs_inject_set_error("a", ESP_OK);
+    CHECK(flash_u32("a") == 5);
+}
+
+static void test_oversized_values(void)
+{
+    char big[101];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    mock_nvs_reset(6 * NVS_PAGE_ENTRIES);
+    flash_set_str("big", big);
+    flash_set_u32("u", 1);
+
+    static nvs_cache_handle_t cache;
+    CHECK(cache_init(&cache, 0, 0) == ESP_OK);
+    char value[128];
+    size_t length = 0;
+    CHECK(nvs_cache_get_str(&cache, "big", NULL, &length) == ESP_OK && length == sizeof(big));
+    length = sizeof(value);
+    CHECK(nvs_cache_get_str(&cache, "big", value, &length) == ESP_OK && strcmp(value, big) == 0);
+    length = 64;
+    CHECK(nvs_cache_get_str(&cache, "big", value, &length) == ESP_ERR_NVS_INVALID_LENGTH);
+    CHECK(nvs_cache_set_str(&cache, "big", big) == ESP_ERR_NVS_INVALID_LENGTH);
+    /* Not every key is cached, so a miss has to ask flash */
+    uint32_t reads = mock_nvs_read_count();
+    CHECK(nvs_cache_get_u32(&cache, "missing", (uint32_t *)value) == ESP_ERR_NVS_NOT_FOUND);
+    CHECK(mock_nvs_read_count() == reads + 1);
+    CHECK(nvs_cache_deinit(&cache) == ESP_OK);
+}
+
+static void test_cache_full(void)
+{
+    mock_nvs_reset(6 * NVS_PAGE_ENTRIES);
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    for (int i = 0; i <= NVS_CACHE_MAX_ENTRIES; i++)
+    {
+        snprintf(key, sizeof(key), "k%d", i);
+        flash_set_u32(key, i);
+    }
+
+    static nvs_cache_handle_t cache;
+    CHECK(cache_init(&cache, 0, 0) == ESP_OK);
+    /* One more key than the cache holds: the last one is read from flash */
+    for (int i = 0; i <= NVS_CACHE_MAX_ENTRIES; i++)
+    {
+        uint32_t k = UINT32_MAX;
+        snprintf(key, sizeof(key), "k%d", i);
+        CHECK(nvs_cache_get_u32(&cache, key, &k) == ESP_OK && k == (uint32_t)i);
+    }
+    CHECK(nvs_cache_set_u32(&cache, "new", 1) == ESP_ERR_NO_MEM);
+    CHECK(nvs_cache_deinit(&cache) == ESP_OK);
+}
+
+int main(void)
+{
+    /* Several cases fail on purpose */
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    test_preload();
+    test_dirty_tracking();
+    test_threshold();
+    test_persisted_keys_first();
+    test_rewrite_in_place();
+    test_rewrite_refused();
+    test_timer_retries();
+    test_deinit();
+    test_oversized_values();
+    test_cache_full();
+
+    if (failures)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All NVS cache tests passed\n");
+    return 0;
+}